@@ -0,0 +1,24 @@
+/*
+ * file: clockstats.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  layout of the clock and scheduler stats filled in by
+ *   Custom2(buf, count, 0, 0), shared with user programs
+ *   (so no kernel includes here)
+ */
+
+#ifndef CLOCKSTATS_H
+#define CLOCKSTATS_H
+
+#define CLOCKSTAT_TICK 0 //clock ticks since boot
+#define CLOCKSTAT_TIMERS_FIRED 1 //timers that have gone off (delays woken)
+#define CLOCKSTAT_TIMERS_MOVED 2 //times a timer moved down the wheel
+#define CLOCKSTAT_POLICY 3 //scheduler picked at boot (1 round robin, 2 mlfq)
+#define CLOCKSTAT_LEVEL 4 //caller's mlfq level (0 is highest, always 0 under round robin)
+#define CLOCKSTAT_DEMOTIONS 5 //times mlfq moved a process down a level
+#define CLOCKSTAT_PROMOTIONS 6 //times it moved one up for waiting on terminal input or a pipe
+#define CLOCKSTAT_BOOSTS 7 //times it moved everyone back to level 0
+#define CLOCKSTAT_COUNT 8
+
+#endif
@@ -25,6 +25,9 @@
 #define CVAR 9
 #define PIPE 10
 
+//process table (pid hash buckets, a pid's bucket is pid % PROC_TABLE_SIZE)
+#define PROC_TABLE_SIZE 128
+
 //abort codes
 #define ABORT 11 
 #define BLOCKED 12
@@ -37,6 +40,102 @@
 #define MAX_PIPES 64
 #define PIPE_ID_OFFSET (MAX_LOCKS + MAX_CVARS)
 
+//page flags (software state kept beside each region 1 pte)
+#define PAGE_COW 0x1 //shared on fork, copy on first write
+#define PAGE_ZERO 0x2 //mapped to the zero frame, real frame on first write
+#define PAGE_FILE 0x4 //not mapped yet, read in from program file on first touch
+#define PAGE_SWAP 0x8 //paged out, pte pfn holds swap slot instead of a frame
+#define PAGE_REF 0x10 //brought in recently, clock hand gives it a second chance
+#define PAGE_SHARED 0x20 //part of a shared memory segment, never copy on write
+#define PAGE_ZCACHE 0x40 //paged out to the compressed store (with PAGE_SWAP), pfn holds its entry
+#define PAGE_SAMPLED 0x80 //pte set to PROT_NONE to see if it's touched, real prot in sampleProt
+
+//kinds of region 1 regions (vmas)
+#define VMA_TEXT 1
+#define VMA_DATA 2 //init data and bss
+#define VMA_HEAP 3 //minBrk up to brk
+#define VMA_STACK 4
+#define VMA_SHARED 5 //shared memory segment
+#define MAX_VMAS 16 //regions a process can have (text, data, heap, stack and shared segments)
+
+//read program text and data in on first touch instead of at exec
+#ifndef LAZY_LOAD
+#define LAZY_LOAD 1
+#endif
+
+//zeroed frame pool (filled by the kernel while idle runs)
+#define ZERO_POOL_SIZE 16 //most frames kept zeroed ahead of time
+#define ZERO_POOL_BATCH 4 //frames zeroed per clock tick spent idle
+
+//region 0 pages just under the kernel stack the kernel maps frames into to copy them
+#define COPY_WINDOW_SLOTS 4
+
+//dead processes are freed a few at a time off the exit path
+#ifndef RECLAIM_BATCH
+#define RECLAIM_BATCH 2 //dead processes freed per clock tick
+#endif
+#ifndef RECLAIM_IDLE_BATCH
+#define RECLAIM_IDLE_BATCH 8 //dead processes freed per clock tick spent idle
+#endif
+
+//free frame watermarks (zero pool counts as free)
+#ifndef FRAMES_LOW_WATER
+#define FRAMES_LOW_WATER 8 //under this the clock handler starts reclaiming
+#endif
+#ifndef FRAMES_HIGH_WATER
+#define FRAMES_HIGH_WATER 16 //reclaiming stops once this many are free
+#endif
+
+//kernel stack frame sets kept from exited processes for the next fork
+#define KSTACK_CACHE_SIZE 8
+
+//swap (pages out to the disk when frames run out)
+#define SECTORS_PER_PAGE (PAGESIZE / SECTORSIZE)
+#define SWAP_SLOTS (NUMSECTORS / SECTORS_PER_PAGE) //pages that fit on the disk
+#define SWAP_BUFFERS 4 //kernel bounce buffers for pages headed to or from disk
+
+//working set sampling (pages dropped to PROT_NONE to see which fault back)
+#ifndef WS_SAMPLE_INTERVAL
+#define WS_SAMPLE_INTERVAL 4 //clock ticks between sampling rounds, 0 turns it off
+#endif
+#define WS_SAMPLE_PAGES 8 //pages of each process sampled per round
+#define WS_COLD_AGE 2 //rounds a page went untouched before it's outside the working set
+#define WS_MAX_AGE 255
+
+//page dedup scanner (runs while idle, 0 pages per tick turns it off)
+#ifndef DEDUP_PAGES_PER_TICK
+#define DEDUP_PAGES_PER_TICK 8 //user pages hashed per idle clock tick
+#endif
+#define DEDUP_TABLE_SIZE 256 //hashes remembered, newer ones push out older
+
+//timer wheel (two levels of slots, later timeouts wait on an overflow list)
+#define TIMER_WHEEL_SLOTS 64 //ticks per level 0 lap, level 0 laps per level 1 lap
+
+//scheduler (picked at boot with "sched=rr" or "sched=mlfq" ahead of the program to run)
+#define SCHED_RR 1 //one ready queue, switch every clock tick
+#define SCHED_MLFQ 2 //multi level feedback queue
+#ifndef SCHED_DEFAULT
+#define SCHED_DEFAULT SCHED_RR
+#endif
+#define MLFQ_LEVELS 4 //priority levels, level 0 runs first
+#define MLFQ_BASE_SLICE 1 //clock ticks a level 0 process gets before it's demoted, doubles each level down
+#ifndef MLFQ_BOOST_INTERVAL
+#define MLFQ_BOOST_INTERVAL 50 //clock ticks between moving everyone back up to level 0
+#endif
+
+//compressed page store (paged out pages kept compressed in memory before going to disk)
+#ifndef ZCACHE_FRAMES
+#define ZCACHE_FRAMES 16 //most frames the store may hold, 0 turns it off
+#endif
+#define ZCACHE_CHUNK 256 //bytes, store frames are handed out in chunks
+#define ZCACHE_CHUNKS_PER_FRAME (PAGESIZE / ZCACHE_CHUNK) //32, one bit each in an unsigned int
+#define ZCACHE_MAX_CHUNKS (ZCACHE_CHUNKS_PER_FRAME / 2) //pages that don't shrink by half go to disk
+#define ZCACHE_ENTRIES (ZCACHE_FRAMES * ZCACHE_CHUNKS_PER_FRAME + 1) //every chunk used by its own page
+
+//shared memory segments
+#define SHM_ANON -1 //key of a segment only reachable through fork
+#define SHM_STACK_GAP 8 //pages left free under the stack for it to grow into
+
 //tty
 #ifndef MAX_TTY
 #define MAX_TTY 8
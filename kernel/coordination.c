@@ -11,21 +11,29 @@
 #include "memory.h"
 #include "structs.h"
 #include "codes.h"
+#include "slab.h"
+#include "timer.h"
 
 
 /*************** local functions ***************/
-pcb_t* dequeue(pcb_t** queue_p);
-int enqueue(pcb_t** queue_p, pcb_t* pcb);
-int remove(pcb_t** queue_p, int pid);
-int contains(pcb_t** queue_p, int pid);
-pcb_t* findLockWaiter(int id);
-pcb_t* findCvarWaiter(int id);
-pcb_t* findPipeWaiter(int id);
+pcbQueue_t* getQueue(int status);
+pcbQueue_t* readyQueue(pcb_t* pcb);
+pcbQueue_t* nextReady();
+void boost();
+pcb_t* dequeue(pcbQueue_t* queue);
+int enqueue(pcbQueue_t* queue, pcb_t* pcb);
+void unqueue(pcb_t* pcb);
+void waitEnqueue(pcbQueue_t* waiters, pcb_t* pcb);
+void waitUnqueue(pcb_t* pcb);
 
 /*************** global variables ***************/
 processes_t* processes;
 pcb_t* idlePCB;
 
+int demotions; //mlfq stats
+int promotions;
+int boosts;
+
 /*************** coord_initProcesses ***************/
 /*
  * see coordination.h
@@ -42,6 +50,10 @@ coord_initProcesses()
     return ERROR;
   }
 
+  //round robin unless boot picks otherwise (see coord_setPolicy)
+  processes->policy = SCHED_DEFAULT;
+  processes->ticksToBoost = MLFQ_BOOST_INTERVAL;
+
   TracePrintf(5, "EXIT coord_initProcesses\n");
   return 0;
 }
@@ -55,41 +67,23 @@ coord_freeProcesses()
 {
   TracePrintf(5, "ENTER coord_freeProcesses\n");
   
-  //free all pcbs (running, idle, and rest on queues)
-  
-  pcb_t* pcb;
-
-  TracePrintf(8, "free running process\n");
-  pcb = coord_getRunningProcess();
-  mem_freePCB(pcb);
-
-  TracePrintf(8, "free idle process\n");
-  pcb = coord_getIdlePCB();
-  mem_freePCB(pcb);
-
-  TracePrintf(8, "free processes on queues\n");
-  while ((pcb = coord_getProcess(READY)) != NULL){
-    mem_freePCB(pcb);
-  }
-
-  while ((pcb = coord_getProcess(ZOMBIE)) != NULL){
-    mem_freePCB(pcb);
-  }
-  
-  while ((pcb = coord_getProcess(BLOCKEDDELAY)) != NULL){
-    mem_freePCB(pcb);
-  }
-
-  while ((pcb = coord_getProcess(BLOCKEDIO)) != NULL){
-    mem_freePCB(pcb);
-  }
-
-  while ((pcb = coord_getProcess(BLOCKEDSYNC)) != NULL){
-    mem_freePCB(pcb);
+  //free all pcbs (running, idle, and rest on queues), they're all in the table
+  for (int bucket = 0; bucket < PROC_TABLE_SIZE; bucket++){
+    pcb_t* pcb = processes->table[bucket];
+    while (pcb != NULL){
+      pcb_t* next = pcb->nextInTable;
+
+      //dead ones that aren't running are already waiting to be freed
+      if (pcb->abort != ABORT || pcb == processes->running){
+        TracePrintf(8, "free process %d (state %d)\n", pcb->pid, coord_getState(pcb));
+        mem_freePCB(pcb);
+      }
+      pcb = next;
+    }
   }
 
-  while ((pcb = coord_getProcess(BLOCKEDWAIT)) != NULL){
-    mem_freePCB(pcb);
+  if (processes->policy == SCHED_MLFQ){
+    TracePrintf(1, "mlfq: %d demotions, %d promotions, %d boosts\n", demotions, promotions, boosts);
   }
 
   free(processes);
@@ -109,11 +103,20 @@ coord_scheduleProcess()
 
   pcb_t* curr = coord_getRunningProcess();
 
+  int numReady = 0;
+  for (int level = 0; level < MLFQ_LEVELS; level++){
+    numReady += processes->ready[level].count;
+  }
+
+  TracePrintf(8, "scheduling with %d ready, %d delayed, %d on io, %d on sync, %d waiting\n",
+      numReady, processes->blockedDelay.count, processes->blockedIO.count,
+      processes->blockedSync.count, processes->blockedWait.count);
+
   pcb_t* next = coord_getProcess(READY);
   if (next == NULL){
     
     //current process can't keep running
-    if (curr->blocked == BLOCKED || curr->abort == ZOMBIE || curr->abort == ABORT) {
+    if (curr->blocked == BLOCKED || curr->abort == ABORT) {
       TracePrintf(3, "next process is null, can't continue with curr process, running idle\n");
       next = coord_getIdlePCB();
     //current process can keep running
@@ -135,6 +138,103 @@ coord_scheduleProcess()
 }
 
 
+/*************** coord_setPolicy ***************/
+/*
+ * see coordination.h
+ */
+int
+coord_setPolicy(int policy)
+{
+  if (policy != SCHED_RR && policy != SCHED_MLFQ){
+    TracePrintf(0, "Invalid policy passed to coord_setPolicy\n");
+    return ERROR;
+  }
+
+  TracePrintf(1, "scheduling with %s\n", policy == SCHED_MLFQ ? "mlfq" : "round robin");
+  processes->policy = policy;
+  return 0;
+}
+
+/*************** coord_clockTick ***************/
+/*
+ * see coordination.h
+ */
+void
+coord_clockTick()
+{
+  pcb_t* curr = coord_getRunningProcess();
+
+  //round robin switches every tick
+  if (processes->policy == SCHED_RR){
+    coord_scheduleProcess();
+    return;
+  }
+
+  //every so often everyone starts over at the top, so long runners
+  //stuck at the bottom can't be starved by a stream of short ones
+  if (--(processes->ticksToBoost) <= 0){
+    boost();
+    processes->ticksToBoost = MLFQ_BOOST_INTERVAL;
+  }
+
+  //idle gives way to anyone
+  if (curr == idlePCB){
+    coord_scheduleProcess();
+    return;
+  }
+
+  //used its whole slice, drop a level and go to the back of it
+  curr->sliceUsed++;
+  if (curr->sliceUsed >= (MLFQ_BASE_SLICE << curr->priority)){
+    if (curr->priority < MLFQ_LEVELS - 1){
+      curr->priority++;
+      demotions++;
+    }
+    curr->sliceUsed = 0;
+    TracePrintf(3, "mlfq: process %d used its slice, now at level %d\n", curr->pid, curr->priority);
+    coord_scheduleProcess();
+    return;
+  }
+
+  //slice left, only someone at a higher level takes the cpu
+  pcbQueue_t* next = nextReady();
+  if (next->head != NULL && next < readyQueue(curr)){
+    coord_scheduleProcess();
+  }
+}
+
+/*************** coord_promote ***************/
+/*
+ * see coordination.h
+ */
+void
+coord_promote(pcb_t* pcb)
+{
+  if (processes->policy != SCHED_MLFQ){
+    return;
+  }
+
+  if (pcb->priority > 0){
+    pcb->priority--;
+    promotions++;
+  }
+  pcb->sliceUsed = 0;
+}
+
+/*************** coord_getStats ***************/
+/*
+ * see coordination.h
+ */
+void
+coord_getStats(int* stats)
+{
+  stats[CLOCKSTAT_POLICY] = processes->policy;
+  stats[CLOCKSTAT_LEVEL] = coord_getRunningProcess()->priority;
+  stats[CLOCKSTAT_DEMOTIONS] = demotions;
+  stats[CLOCKSTAT_PROMOTIONS] = promotions;
+  stats[CLOCKSTAT_BOOSTS] = boosts;
+}
+
 /*************** coord_setRunningProcess ***************/
 /*
  * see coordination.h
@@ -182,45 +282,25 @@ int
 coord_addProcess(pcb_t* pcb, int status)
 {
   TracePrintf(5, "ENTER coord_addProcess\n");
-  int rc = 0;
 
-  switch (status){
-    case READY:
-      TracePrintf(5, "Adding process %d to ready queue\n", pcb->pid);
-      pcb->blocked = 0;
-      rc = enqueue(&(processes->ready), pcb);
-      break;
-    case ZOMBIE:
-      TracePrintf(5, "Adding process %d to zombie queue\n", pcb->pid);
-      pcb->blocked = BLOCKED;
-      rc = enqueue(&(processes->zombie), pcb);
-      break;
-    case BLOCKEDDELAY:
-      TracePrintf(5, "Adding process %d to blocked (delay) queue\n", pcb->pid);
-      pcb->blocked = BLOCKED;
-      rc = enqueue(&(processes->blockedDelay), pcb);
-      break;
-    case BLOCKEDIO:
-      TracePrintf(5, "Adding process %d to blocked (io) queue\n", pcb->pid);
-      pcb->blocked = BLOCKED;
-      rc = enqueue(&(processes->blockedIO), pcb);
-      break;
-    case BLOCKEDSYNC:
-      TracePrintf(5, "Adding process %d to blocked (sync) queue\n", pcb->pid);
-      pcb->blocked = BLOCKED;
-      rc = enqueue(&(processes->blockedSync), pcb);
-      break;
-    case BLOCKEDWAIT:
-      TracePrintf(5, "Adding process %d to blocked (wait) queue\n", pcb->pid);
-      pcb->blocked = BLOCKED;
-      rc = enqueue(&(processes->blockedWait), pcb);
-      break;
-    default:
-      TracePrintf(0, "Invalid status passed to coord_addProcess\n");
-      rc = ERROR;
-      break;
+  pcbQueue_t* queue = getQueue(status);
+  if (queue == NULL){
+    TracePrintf(0, "Invalid status passed to coord_addProcess\n");
+    return ERROR;
   }
 
+  //ready processes line up at their own level
+  if (status == READY){
+    queue = readyQueue(pcb);
+  }
+
+  TracePrintf(5, "Adding process %d to queue %d\n", pcb->pid, status);
+  pcb->blocked = (status == READY) ? 0 : BLOCKED;
+
+  //whatever it was waiting on is done with it (coord_blockOn puts it back on one after)
+  waitUnqueue(pcb);
+  int rc = enqueue(queue, pcb);
+
   TracePrintf(5, "EXIT coord_addProcess\n"); 
   return rc;
 }
@@ -234,37 +314,20 @@ coord_getProcess(int status)
 {
   TracePrintf(5, "ENTER coord_getProcess\n");
   
-  pcb_t* rPCB = NULL;
-  switch (status){
-    case READY:
-      TracePrintf(5, "Dequeueing process from ready queue\n");
-      rPCB = dequeue(&(processes->ready));
-      break;
-    case ZOMBIE:
-      TracePrintf(5, "Dequeueing process from zombie queue\n");
-      rPCB = dequeue(&(processes->zombie));
-      break;
-    case BLOCKEDDELAY:
-      TracePrintf(5, "Dequeueing from blocked (delay) queue\n");
-      rPCB = dequeue(&(processes->blockedDelay));
-      break;
-    case BLOCKEDIO:
-      TracePrintf(5, "Dequeueing process from blocked (io) queue\n");
-      rPCB = dequeue(&(processes->blockedIO));
-      break;
-    case BLOCKEDSYNC:
-      TracePrintf(5, "Dequeueing process from blocked (sync) queue\n");
-      rPCB = dequeue(&(processes->blockedSync));
-      break;
-    case BLOCKEDWAIT:
-      TracePrintf(5, "Dequeueing process from blocked (wait) queue\n");
-      rPCB = dequeue(&(processes->blockedSync));
-      break;
-    default:
-      TracePrintf(0, "Invalid status passed to coord_getProcess\n");
-      break;
+  pcbQueue_t* queue = getQueue(status);
+  if (queue == NULL){
+    TracePrintf(0, "Invalid status passed to coord_getProcess\n");
+    return NULL;
+  }
+
+  //highest level with anyone on it goes first
+  if (status == READY){
+    queue = nextReady();
   }
 
+  TracePrintf(5, "Dequeueing process from queue %d\n", status);
+  pcb_t* rPCB = dequeue(queue);
+
   TracePrintf(5, "EXIT coord_getProcess\n"); 
   return rPCB;
 }
@@ -274,48 +337,30 @@ coord_getProcess(int status)
  * see coordination.h
  */
 int
-coord_removeProcess(int pid, int status)
+coord_removeProcess(pcb_t* pcb, int status)
 {
   TracePrintf(5, "ENTER coord_removeProcess\n");
-  int rc;
 
-  switch (status){
-    case READY:
-      TracePrintf(5, "Removing process %d from ready queue\n", pid);
-      rc = remove(&(processes->ready), pid);
-      break;
-    case ZOMBIE:
-      TracePrintf(5, "Removing process %d from zombie queue\n", pid);
-      rc = remove(&(processes->zombie), pid);
-      break;
-    case BLOCKEDDELAY:
-      TracePrintf(5, "Removing process %d from blocked (delay) queue\n", pid);
-      rc = remove(&(processes->blockedDelay), pid);
-      break;
-    case BLOCKEDIO:
-      TracePrintf(5, "Removing process %d from blocked (io) queue\n", pid);
-      rc = remove(&(processes->blockedIO), pid);
-      break;
-    case BLOCKEDSYNC:
-      TracePrintf(5, "Removing process %d from blocked (sync) queue\n", pid);
-      rc = remove(&(processes->blockedSync), pid);
-      break;
-    case BLOCKEDWAIT:
-      TracePrintf(5, "Removing process %d from blocked (wait) queue\n", pid);
-      rc = remove(&(processes->blockedWait), pid);
-      break;
-    default:
-      TracePrintf(0, "Invalid status passed to coord_removeProcess\n");
-      rc = ERROR;
-      break;
+  pcbQueue_t* queue = getQueue(status);
+  if (queue == NULL){
+    TracePrintf(0, "Invalid status passed to coord_removeProcess\n");
+    return ERROR;
+  }
+  if (status == READY && pcb != NULL){
+    queue = readyQueue(pcb);
   }
 
-  if (rc == 1){
-    TracePrintf(8, "PID %d found and removed (returning 1)\n");
+  //each pcb knows its queue, no searching
+  if (pcb == NULL || pcb->queue != queue){
+    TracePrintf(5, "EXIT coord_removeProcess (not found)\n"); 
+    return 0;
   }
 
+  TracePrintf(8, "Removing process %d from queue %d\n", pcb->pid, status);
+  unqueue(pcb);
+
   TracePrintf(5, "EXIT coord_removeProcess\n"); 
-  return rc;
+  return 1;
 }
 
 /*************** coord_containsProcess***************/
@@ -323,134 +368,83 @@ coord_removeProcess(int pid, int status)
  * see coordination.h
  */
 int
-coord_containsProcess(int pid, int status)
+coord_containsProcess(pcb_t* pcb, int status)
 {
-  TracePrintf(5, "ENTER coord_containsProcess\n");
-  int rc;
-
-  switch (status){
-    case READY:
-      TracePrintf(5, "Checking for process %d in ready queue\n", pid);
-      rc = contains(&(processes->ready), pid);
-      break;
-    case ZOMBIE:
-      TracePrintf(5, "Checking for process %d in zombie queue\n", pid);
-      rc = contains(&(processes->zombie), pid);
-      break;
-    case BLOCKEDDELAY:
-      TracePrintf(5, "Checking for process %d in blocked (delay) queue\n", pid);
-      rc = contains(&(processes->blockedDelay), pid);
-      break;
-    case BLOCKEDIO:
-      TracePrintf(5, "Checking for process %d in blocked (io) queue\n", pid);
-      rc = contains(&(processes->blockedIO), pid);
-      break;
-    case BLOCKEDSYNC:
-      TracePrintf(5, "Checking for process %d in blocked (sync) queue\n", pid);
-      rc = contains(&(processes->blockedSync), pid);
-      break;
-    case BLOCKEDWAIT:
-      TracePrintf(5, "Checking for process %d in blocked (wait) queue\n", pid);
-      rc = contains(&(processes->blockedWait), pid);
-      break;
-    default:
-      TracePrintf(0, "Invalid status passed to coord_containsProcess\n");
-      rc = ERROR;
-      break;
+  pcbQueue_t* queue = getQueue(status);
+  if (queue == NULL){
+    TracePrintf(0, "Invalid status passed to coord_containsProcess\n");
+    return ERROR;
+  }
+  if (status == READY && pcb != NULL){
+    queue = readyQueue(pcb);
   }
 
-  TracePrintf(5, "EXIT coord_removeProcess\n"); 
-  return rc;
+  return pcb != NULL && pcb->queue == queue;
 }
 
-/*************** coord_findSyncWaiter ***************/
+/*************** coord_blockOn ***************/
 /*
  * see coordination.h
  */
-pcb_t*
-coord_findSyncWaiter(int id, int type)
+int
+coord_blockOn(pcb_t* pcb, pcbQueue_t* waiters, int status)
 {
-  TracePrintf(5, "ENTER coord_findSyncWaiter\n");
-
-  pcb_t* waiter = NULL;
-
-  switch (type){
-    case LOCK:
-      waiter = findLockWaiter(id);
-      break;
-    case CVAR:
-      waiter = findCvarWaiter(id);
-      break;
-    case PIPE:
-      waiter = findPipeWaiter(id);
-      break;
-    default:
-      TracePrintf(0, "Invalid type passed to coord_findSyncWaiter\n");
-      break;
-  }
+  TracePrintf(5, "ENTER coord_blockOn\n");
 
-  if (waiter == NULL){
-    TracePrintf(5, "waiter not found\n");
+  if (status == READY || coord_addProcess(pcb, status) == ERROR){
+    TracePrintf(0, "Failed to block process %d\n", pcb->pid);
+    return ERROR;
   }
+  waitEnqueue(waiters, pcb);
 
-  TracePrintf(5, "EXIT coord_findSyncWaiter\n");
-  return waiter;
+  TracePrintf(5, "EXIT coord_blockOn (%d waiting)\n", waiters->count);
+  return 0;
 }
 
-/*************** coord_findTtyReadWaiter ***************/
+/*************** coord_getWaiter ***************/
 /*
  * see coordination.h
  */
 pcb_t*
-coord_findTtyReadWaiter(int tty_id)
+coord_getWaiter(pcbQueue_t* waiters)
 {
-  TracePrintf(5, "ENTER findTtyReadWaiter for tty %d\n", tty_id);
-  //find process in blockedIO queue waiting for tty
-  pcb_t **queue_p = &(processes->blockedIO);
-  if (queue_p == NULL || *queue_p == NULL) {
-    TracePrintf(5, "findTtyReadWaiter: no processes in BLOCKEDIO\n");
-    return NULL;
+  pcb_t* waiter = waiters->head;
+  if (waiter != NULL){
+    waitUnqueue(waiter);
   }
-  pcb_t *ptr = *queue_p;
-  //iterate through blockedIO queue
-  while (ptr != NULL) {
-    if (ptr->ttyReadWaiting == tty_id) {
-      TracePrintf(5, "findTtyReadWaiter: found process %d waiting for tty %d\n", ptr->pid, tty_id);
-      return ptr;
-    }
-    ptr = ptr->next;
-  }
-  //no process found
-  TracePrintf(5, "findTtyReadWaiter: no process waiting for tty %d\n", tty_id);
-  return NULL;
+
+  return waiter;
 }
 
-/*************** coord_findTtyWriteWaiter ***************/
+/*************** coord_wakeOne ***************/
 /*
  * see coordination.h
  */
 pcb_t*
-coord_findTtyWriteWaiter(int tty_id)
+coord_wakeOne(pcbQueue_t* waiters)
 {
-  TracePrintf(5, "ENTER findTtyWriteWaiter for tty %d\n", tty_id);
-  //find process in blockedIO queue waiting for tty
-  pcb_t **queue_p = &(processes->blockedIO);
-  if (queue_p == NULL || *queue_p == NULL) {
-    TracePrintf(5, "findTtyWriteWaiter: no processes in BLOCKEDIO\n");
-    return NULL;
+  pcb_t* waiter = coord_getWaiter(waiters);
+  if (waiter != NULL){
+    TracePrintf(3, "Waking process %d\n", waiter->pid);
+    coord_addProcess(waiter, READY);
   }
-  //iterate through blockedIO queue
-  pcb_t *ptr = *queue_p;
-  while (ptr != NULL) {
-    if (ptr->ttyWriteWaiting == tty_id) {
-      TracePrintf(5, "findTtyWriteWaiter: found process %d waiting for tty %d\n", ptr->pid, tty_id);
-      return ptr;
-    }
-    ptr = ptr->next;
+
+  return waiter;
+}
+
+/*************** coord_wakeAll ***************/
+/*
+ * see coordination.h
+ */
+int
+coord_wakeAll(pcbQueue_t* waiters)
+{
+  int woken = 0;
+  while (coord_wakeOne(waiters) != NULL){
+    woken++;
   }
-  //no process found
-  TracePrintf(5, "findTtyWriteWaiter: no process waiting for tty %d\n", tty_id);
-  return NULL;
+
+  return woken;
 }
 
 //--------------------------------------------------------
@@ -471,26 +465,14 @@ coord_addChild(pcb_t* parent, pcb_t* child)
     TracePrintf(5, "one of the PCBs is null\n");
     return ERROR;
   }
-  
-  //set nextSibling to NULL
-  child->nextSibling = NULL;
-
-  //add to child queue (empty)
-  pcb_t** queue_p = &(parent->children);
-  if (*queue_p == NULL){
-    TracePrintf(5, "Nothing in queue, setting first element to pid %d\n", child->pid);
-    *queue_p = child;
-
-    TracePrintf(5, "EXIT coord_addChild\n");
-    return 0;
-  }
 
-  //add to child queue (items in queue)
-  pcb_t* ptr = *queue_p; 
-  while (ptr->nextSibling != NULL){
-    ptr = ptr->nextSibling;
+  //order doesn't matter, newest goes first
+  child->prevSibling = NULL;
+  child->nextSibling = parent->children;
+  if (parent->children != NULL){
+    parent->children->prevSibling = child;
   }
-  ptr->nextSibling = child;
+  parent->children = child;
 
   TracePrintf(5, "EXIT coord_addChild\n");
   return 0;
@@ -505,74 +487,56 @@ coord_removeChild(pcb_t* parent, int pid)
 {
   TracePrintf(5, "ENTER coord_removeChild\n");
 
-  //if queue is empty, return error
-  pcb_t** queue_p = &(parent->children); 
-  if (queue_p == NULL || *queue_p == NULL){
+  //look the child up instead of walking the siblings
+  pcb_t* child = coord_findProcess(pid);
+  if (child == NULL || child->parent != parent){
+    TracePrintf(5, "EXIT coord_removeChild (fail)\n");
     return ERROR;
   }
 
-  //first item is child
-  if ((*queue_p)->pid == pid){
-    *queue_p = (*queue_p)->nextSibling;
-    TracePrintf(5, "EXIT coord_removeChild (success)\n");
-    return 0;
+  if (child->prevSibling != NULL){
+    child->prevSibling->nextSibling = child->nextSibling;
+  } else {
+    parent->children = child->nextSibling;
   }
-
-  //search through queue for child
-  pcb_t* ptr = *queue_p;
-  while (ptr->nextSibling != NULL){
-    if (ptr->nextSibling->pid == pid){
-      ptr->nextSibling = ptr->nextSibling->nextSibling;
-      TracePrintf(5, "EXIT coord_removeChild (success)\n");
-      return 0;
-    }
+  if (child->nextSibling != NULL){
+    child->nextSibling->prevSibling = child->prevSibling;
   }
+  child->nextSibling = NULL;
+  child->prevSibling = NULL;
 
-  //didn't find
-  TracePrintf(5, "EXIT coord_removeChild (fail)\n");
-  return ERROR;
+  TracePrintf(5, "EXIT coord_removeChild (success)\n");
+  return 0;
 }
 
-/*************** coord_killZombieChildren ***************/
+/*************** coord_orphanChildren ***************/
 /*
  * see coordination.h
  */
-int
-coord_killZombieChildren(pcb_t* parent)
+void
+coord_orphanChildren(pcb_t* parent)
 {
-  TracePrintf(5, "ENTER coord_killZombieChildren\n");
-
-  //return error if queue is empty
-  pcb_t** queue_p = &(parent->children); 
-  if (queue_p == NULL || *queue_p == NULL){
-    TracePrintf(5, "EXIT coord_killZombieChildren\n");
-    return 0;
+  TracePrintf(5, "ENTER coord_orphanChildren\n");
+
+  //children still running have no one to report to anymore
+  pcb_t* child = parent->children;
+  while (child != NULL){
+    pcb_t* next = child->nextSibling;
+    child->parent = NULL;
+    child->nextSibling = NULL;
+    child->prevSibling = NULL;
+    child = next;
   }
+  parent->children = NULL;
 
-  //for each item in queue, remove them from zombies if they are there
-  pcb_t* ptr = *queue_p;
-  while (ptr != NULL){
-    int rc = remove(&(processes->zombie), ptr->pid);
-    if (rc == ERROR){
-      TracePrintf(0, "Invalid remove\n");
-      return ERROR;
-    }
-    pcb_t* next = ptr->nextSibling;
-
-    //was a zombie process
-    if (rc == 1){
-
-      //remove child from zombie queue
-      coord_removeChild(parent, ptr->pid);
-      ptr->parent = NULL;
-      coord_abort(ptr, 0);
-    }
-
-    ptr = next;
+  //no one will wait on the ones already gone
+  while (parent->exited != NULL){
+    exitRecord_t* record = parent->exited;
+    parent->exited = record->next;
+    slab_free(&exitCache, record);
   }
 
-  TracePrintf(5, "EXIT coord_killZombieChildren\n");
-  return 0;
+  TracePrintf(5, "EXIT coord_orphanChildren\n");
 }
 
 
@@ -600,6 +564,131 @@ coord_getIdlePCB()
   return idlePCB;
 } 
 
+/*************** coord_listProcesses ***************/
+/*
+ * see coordination.h
+ */
+int
+coord_listProcesses(pcb_t** procs, int max)
+{
+  if (processes == NULL){
+    return 0;
+  }
+
+  int numProcs = 0;
+  for (int bucket = 0; bucket < PROC_TABLE_SIZE; bucket++){
+    for (pcb_t* pcb = processes->table[bucket]; pcb != NULL && numProcs < max; pcb = pcb->nextInTable){
+
+      //idle isn't a real process, dying ones are on their way out
+      if (pcb == idlePCB || pcb->abort == ABORT){
+        continue;
+      }
+
+      //insertion sort, there are never many
+      int i = numProcs++;
+      while (i > 0 && procs[i - 1]->pid > pcb->pid){
+        procs[i] = procs[i - 1];
+        i--;
+      }
+      procs[i] = pcb;
+    }
+  }
+
+  return numProcs;
+}
+
+//--------------------------------------------------------
+/****************** process table  **********************/
+//--------------------------------------------------------
+
+/*************** coord_registerProcess ***************/
+/*
+ * see coordination.h
+ */
+void
+coord_registerProcess(pcb_t* pcb)
+{
+  pcb_t** bucket = &(processes->table[pcb->pid % PROC_TABLE_SIZE]);
+  pcb->nextInTable = *bucket;
+  *bucket = pcb;
+  processes->numProcs++;
+
+  TracePrintf(5, "coord_registerProcess: process %d (%d in table)\n", pcb->pid, processes->numProcs);
+}
+
+/*************** coord_unregisterProcess ***************/
+/*
+ * see coordination.h
+ */
+void
+coord_unregisterProcess(pcb_t* pcb)
+{
+  if (processes == NULL || pcb->pid < 0){
+    return;
+  }
+
+  //buckets hold a pid or two, a short walk to find the link to cut
+  pcb_t** link = &(processes->table[pcb->pid % PROC_TABLE_SIZE]);
+  while (*link != NULL && *link != pcb){
+    link = &((*link)->nextInTable);
+  }
+
+  if (*link == pcb){
+    *link = pcb->nextInTable;
+    pcb->nextInTable = NULL;
+    processes->numProcs--;
+  }
+}
+
+/*************** coord_findProcess ***************/
+/*
+ * see coordination.h
+ */
+pcb_t*
+coord_findProcess(int pid)
+{
+  if (processes == NULL || pid < 0){
+    return NULL;
+  }
+
+  pcb_t* pcb = processes->table[pid % PROC_TABLE_SIZE];
+  while (pcb != NULL && pcb->pid != pid){
+    pcb = pcb->nextInTable;
+  }
+
+  return pcb;
+}
+
+/*************** coord_getState ***************/
+/*
+ * see coordination.h
+ */
+int
+coord_getState(pcb_t* pcb)
+{
+  if (pcb->abort == ABORT){
+    return ZOMBIE;
+  }
+
+  if (pcb == processes->running){
+    return RUNNING;
+  }
+
+  if (pcb->queue == readyQueue(pcb)){
+    return READY;
+  }
+
+  //each blocked queue is one state
+  int states[] = {BLOCKEDDELAY, BLOCKEDIO, BLOCKEDSYNC, BLOCKEDWAIT};
+  for (int i = 0; i < sizeof(states) / sizeof(states[0]); i++){
+    if (pcb->queue == getQueue(states[i])){
+      return states[i];
+    }
+  }
+
+  return ERROR;
+}
+
 //--------------------------------------------------------
 /****************** abort functions  ********************/
 //--------------------------------------------------------
@@ -622,45 +711,55 @@ coord_abort(pcb_t* pcb, int error)
   //collect parent
   pcb_t* parent = pcb->parent;
 
-  //if needs to become zombie (half abort, will full abort later)
+  //parent still alive, all it gets to keep of us is an exit record
   if (parent != NULL){
-    pcb->abort = ZOMBIE;
-    if (coord_containsProcess(parent->pid, BLOCKEDWAIT) == 1){
+    exitRecord_t* record = pcb->exitRecord;
+    pcb->exitRecord = NULL;
+    record->pid = pid;
+    record->status = error;
+    record->next = NULL;
+
+    exitRecord_t** tail = &(parent->exited);
+    while (*tail != NULL){
+      tail = &((*tail)->next);
+    }
+    *tail = record;
 
-      //parent found on BLOCKEDWAIT, removed from block and add to ready
-      rc = coord_removeProcess(parent->pid, BLOCKEDWAIT);
-      if (rc == ERROR){
-        TracePrintf(0, "Failed to swap parent to ready\n");
-        return rc;
-      }
+    coord_removeChild(parent, pid);
+    pcb->parent = NULL;
+
+    if (coord_containsProcess(parent, BLOCKEDWAIT) == 1){
+
+      //parent found on BLOCKEDWAIT, move it to ready
       rc = coord_addProcess(parent, READY);
       if (rc == ERROR){
         TracePrintf(0, "Failed to swap parent to ready\n");
         return rc;
       }
     }
-    
-    //wait on zombie queue, parent will eventually need me
-    coord_addProcess(pcb, ZOMBIE);
+  }
 
-  //no parent, fully abort child
-  } else {
-    TracePrintf(8, "PID %d: No parent, it's time to go\n", pcb->pid);
+  //our children carry on without us
+  coord_orphanChildren(pcb);
 
-    //clear all zombie children of process
-    if (coord_killZombieChildren(pcb) == ERROR){
-      TracePrintf(0, "Failed to remove zombie children\n");
-      return 0;
-    }
+  //whatever it was waiting on, it isn't anymore
+  unqueue(pcb);
+  waitUnqueue(pcb);
+  timer_cancel(&(pcb->delayTimer));
 
-    //if i'm current proc, can't abort til after kcswitch
-    curr = coord_getRunningProcess();
-    if (curr == pcb){
-      pcb->abort = ABORT; //flag that it needs to be aborted, will abort at end of kc switch (last time pcb needed)
-    } else {
-      //never needed again
-      mem_freePCB(pcb);
-    }
+  //give back its memory now, only the pcb, page table and kernel stack wait for the reclaim list
+  TracePrintf(8, "PID %d: giving back address space, rest is freed later\n", pcb->pid);
+  mem_freeAddressSpace(pcb);
+
+  //if i'm current proc, can't free the pcb til after kcswitch (still on its kernel stack)
+  //(the flag also marks it dead in the process table til it's freed)
+  pcb->abort = ABORT;
+  curr = coord_getRunningProcess();
+  if (curr == pcb){
+    TracePrintf(5, "aborting running process, freed at end of kc switch (last time pcb needed)\n");
+  } else {
+    //never needed again, freed off the exit path
+    mem_deferFreePCB(pcb);
   }
 
   //halt system if aborting initial proc
@@ -713,10 +812,10 @@ KCSwitch(KernelContext* kc_in, void* curr_pcb_p, void* next_pcb_p)
     coord_addProcess(curr, READY);
   }
 
-  //no longer need curr process
+  //no longer need curr process, it gets freed later (see mem_drainReclaim)
   if (curr->abort == ABORT){
-    TracePrintf(3, "current process needs aborted, freeing it\n");
-    mem_freePCB(curr);
+    TracePrintf(3, "current process needs aborted, putting it on reclaim list\n");
+    mem_deferFreePCB(curr);
   }
 
   TracePrintf(5, "EXIT KCSwitch\n");
@@ -733,36 +832,17 @@ KCCopy(KernelContext* kc_in, void* new_pcb_p, void* not_used)
   TracePrintf(5, "ENTER KCCopy \n");
   
   pcb_t* newPCB = (pcb_t*)new_pcb_p;
-  pte_t* kernelPT = mem_getKernelPT();
 
   //copy parents kernel context
   memcpy(&(newPCB->kc), kc_in, sizeof(KernelContext));
 
   //get stack pages
   int stackSize = (KERNEL_STACK_MAXSIZE / PAGESIZE);
-  int firstStackPage = (KERNEL_STACK_BASE >> PAGESHIFT);
-
 
-  //initialize temp page under kernel stack to use to copy
-  kernelPT[firstStackPage - 1].prot = (PROT_READ | PROT_WRITE);
-  kernelPT[firstStackPage - 1].valid = 1;
-
-  //for each frame in kernel stack frames
-  for (int page = 0; page < stackSize; page++){
-
-    //set up first frame below stack as temporary alias to frame # for new stack
-    kernelPT[firstStackPage - 1].pfn = newPCB->kstack[page];
-    WriteRegister(REG_TLB_FLUSH, ((firstStackPage - 1) << PAGESHIFT));
-
-    //copy over the contents from current stack frame to aliased virtual mem that points to correct pfn
-    memcpy((void*)((firstStackPage - 1) << PAGESHIFT), (void*)(((firstStackPage + page) << PAGESHIFT)), PAGESIZE);
-  }
-
-  //unuse page under kernel stack
-  kernelPT[firstStackPage - 1].valid = 0;
-  kernelPT[firstStackPage - 1].prot = PROT_NONE;
- 
-  WriteRegister(REG_TLB_FLUSH, ((firstStackPage - 1) << PAGESHIFT));
+  //map all the new stack frames into the copy window and copy the whole stack in one go
+  void* window = mem_mapWindow(newPCB->kstack, stackSize);
+  memcpy(window, (void*)KERNEL_STACK_BASE, KERNEL_STACK_MAXSIZE);
+  mem_unmapWindow(stackSize);
 
   TracePrintf(5, "EXIT KCCopy \n");
   return kc_in;
@@ -772,271 +852,280 @@ KCCopy(KernelContext* kc_in, void* new_pcb_p, void* not_used)
 /****************** local functions  ********************/
 //--------------------------------------------------------
 
-/******************** function ********************/
+/******************** getQueue ********************/
 /*
- * this snippet of code does this
+ * queue holding processes in a given state
  *
  * input:
+ *  status - code (see codes.h) of the queue
  *
  * output:
+ *  return queue
+ *  return NULL if status isn't a queue
  *
- * notes:
  */
-int
-enqueue(pcb_t** queue_p, pcb_t* pcb)
+pcbQueue_t*
+getQueue(int status)
 {
-  TracePrintf(5, "ENTER enqueue\n");
-
-  if (pcb == NULL){
-    TracePrintf(5, "PCB is null\n");
-    return ERROR;
-  }
-  pcb->next = NULL;
-
-  if (*queue_p == NULL){
-    TracePrintf(5, "Nothing in queue, setting first element to pid %d\n", pcb->pid);
-    *queue_p = pcb;
-    return 0;
-  }
-
-  pcb_t* ptr = *queue_p; 
-  TracePrintf(7, "Items in queue, let's traverse through and add to end\n");
-  while (ptr->next != NULL){
-    ptr = ptr->next;
+  switch (status){
+    case READY:
+      return &(processes->ready[0]);
+    case BLOCKEDDELAY:
+      return &(processes->blockedDelay);
+    case BLOCKEDIO:
+      return &(processes->blockedIO);
+    case BLOCKEDSYNC:
+      return &(processes->blockedSync);
+    case BLOCKEDWAIT:
+      return &(processes->blockedWait);
+    default:
+      return NULL;
   }
-  ptr->next = pcb;
-
-  TracePrintf(5, "EXIT enqueue\n");
-  return 0;
 }
 
-
-/******************** dequeue ********************/
+/******************** readyQueue ********************/
 /*
- * dequeue item from start of given queue
+ * ready queue a process belongs on
  *
  * input:
- *  queue_p - pointer to queue to dequeue
+ *  pcb - process
  *
  * output:
- *  pcb that gets dequeued 
- *  NULL if none found
+ *  return the queue for its mlfq level (level 0 under round robin)
  *
  */
-pcb_t*
-dequeue(pcb_t** queue_p)
+pcbQueue_t*
+readyQueue(pcb_t* pcb)
 {
-  TracePrintf(5, "ENTER dequeue\n");
-
-  if (queue_p == NULL){
-    TracePrintf(7, "IN DEQUEUE pointer to q is null\n");
-    return NULL;
-  }
-
-  if (*queue_p == NULL){
-    TracePrintf(7, "IN DEQUEUE q is null\n");
-    return NULL;
+  if (processes->policy == SCHED_MLFQ){
+    return &(processes->ready[pcb->priority]);
   }
-
-
-  //get first item from queue, set queue to point to next
-  pcb_t* rPCB = *queue_p;
-  *queue_p = (*queue_p)->next;
-
-  TracePrintf(5, "EXIT dequeue w/ pid: %d\n", rPCB->pid);
-  return rPCB;
+  return &(processes->ready[0]);
 }
 
-/******************** remove ********************/
+/******************** nextReady ********************/
 /*
- * remove a given pid from a given queue
+ * ready queue to run from next
  *
  * input:
- *  queue_p - pointer to queue to remove from
- *  pid - pid of process to remove from queue
+ *  none
  *
  * output:
- *  return 0 if not found
- *  return 1 if found and removed
+ *  return the highest level ready queue with anyone on it
+ *   (level 0, empty, if no one is ready)
  *
  */
-int
-remove(pcb_t** queue_p, int pid)
+pcbQueue_t*
+nextReady()
 {
-  TracePrintf(5, "ENTER remove\n");
-
-  if (queue_p == NULL || *queue_p == NULL){
-    TracePrintf(5, "EXIT remove (not found)\n");
-    return 0;
+  for (int level = 0; level < MLFQ_LEVELS; level++){
+    if (processes->ready[level].head != NULL){
+      return &(processes->ready[level]);
+    }
   }
+  return &(processes->ready[0]);
+}
 
-  //remove first item
-  if ((*queue_p)->pid == pid){
-    *queue_p = (*queue_p)->next;
-    TracePrintf(5, "EXIT remove (found and removed)\n");
-    return 1;
+/******************** boost ********************/
+/*
+ * move every process back up to mlfq level 0 with a fresh slice
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  ready ones keep their order, higher levels ahead of lower
+ *
+ */
+void
+boost()
+{
+  for (int level = 1; level < MLFQ_LEVELS; level++){
+    pcb_t* pcb;
+    while ((pcb = dequeue(&(processes->ready[level]))) != NULL){
+      enqueue(&(processes->ready[0]), pcb);
+    }
   }
 
-  //search through queue and find
-  pcb_t* ptr = *queue_p;
-  while (ptr->next != NULL){
-    if (ptr->next->pid == pid){
-      ptr->next = ptr->next->next;
-      TracePrintf(5, "EXIT remove (found and removed)\n");
-      return 1;
+  //blocked and running ones too, they come back at the top
+  for (int bucket = 0; bucket < PROC_TABLE_SIZE; bucket++){
+    for (pcb_t* pcb = processes->table[bucket]; pcb != NULL; pcb = pcb->nextInTable){
+      pcb->priority = 0;
+      pcb->sliceUsed = 0;
     }
-    ptr = ptr->next;
   }
 
-  TracePrintf(5, "EXIT remove (not found)\n");
-  return 0;
+  boosts++;
+  TracePrintf(3, "mlfq: boosted %d processes to level 0\n", processes->numProcs);
 }
 
-/******************** contains ********************/
+/******************** enqueue ********************/
 /*
- * check if given pid exists within a queue
+ * add a pcb to the back of a queue
  *
  * input:
- *  queue_p - pointer to queue to search in 
- *  pid - pid of process to find in queue
+ *  queue - queue to add to
+ *  pcb - pcb to add (taken off any queue it's already on)
  *
  * output:
- *  return 0 if not found
- *  return 1 if found
+ *  return 0 on success
+ *  return ERROR if pcb is null
  *
  */
 int
-contains(pcb_t** queue_p, int pid)
+enqueue(pcbQueue_t* queue, pcb_t* pcb)
 {
-  TracePrintf(5, "ENTER contains\n");
+  TracePrintf(5, "ENTER enqueue\n");
 
-  if (queue_p == NULL || *queue_p == NULL){
-    TracePrintf(5, "EXIT contains (not found)\n");
-    return 0;
+  if (pcb == NULL){
+    TracePrintf(5, "PCB is null\n");
+    return ERROR;
   }
 
-  //search through queue
-  pcb_t* ptr = *(queue_p); 
-  while (ptr != NULL){
-    if (ptr->pid == pid){
-      TracePrintf(5, "EXIT contains (found)\n");
-      return 1;
-    }
-    ptr = ptr->next;
+  //a pcb can only be on one queue, its links would get crossed otherwise
+  if (pcb->queue != NULL){
+    TracePrintf(3, "enqueue: process %d moved off its old queue\n", pcb->pid);
+    unqueue(pcb);
   }
 
-  TracePrintf(5, "EXIT contains (not found)\n");
+  pcb->next = NULL;
+  pcb->prev = queue->tail;
+  if (queue->tail != NULL){
+    queue->tail->next = pcb;
+  } else {
+    queue->head = pcb;
+  }
+  queue->tail = pcb;
+  queue->count++;
+  pcb->queue = queue;
+
+  TracePrintf(5, "EXIT enqueue\n");
   return 0;
 }
 
-/******************** findLockWaiter ********************/
+
+/******************** dequeue ********************/
 /*
- * find a waiter in the blocked sync queue corresponding to
- * a lock id
+ * dequeue item from start of given queue
  *
  * input:
- *  int id - lock id to search for
+ *  queue - queue to dequeue from
  *
  * output:
- *  return pcb of waiter if found
- *  return 1 if found
+ *  pcb that gets dequeued 
+ *  NULL if none found
  *
  */
 pcb_t*
-findLockWaiter(int id)
+dequeue(pcbQueue_t* queue)
 {
-  TracePrintf(5, "ENTER findLockWaiter\n");
+  TracePrintf(5, "ENTER dequeue\n");
 
-  pcb_t** queue_p = &(processes->blockedSync);
-  if (queue_p == NULL || *queue_p == NULL){
-    TracePrintf(5, "EXIT findLockWaiter (not found)\n");
+  pcb_t* rPCB = queue->head;
+  if (rPCB == NULL){
+    TracePrintf(7, "IN DEQUEUE q is empty\n");
     return NULL;
   }
 
-  //search through items in queue, return first one waiting on lock
-  pcb_t* ptr = *(queue_p); 
-  while (ptr != NULL){
-    if (ptr->lockID == id){
-      TracePrintf(5, "EXIT findLockWaiter (found proc %d waiting for lock %d)\n", ptr->pid, id);
-      return ptr;
-    }
-    ptr = ptr->next;
-  }
-  TracePrintf(5, "EXIT findLockWaiter (not found)\n");
-  return NULL;
+  unqueue(rPCB);
+
+  TracePrintf(5, "EXIT dequeue w/ pid: %d\n", rPCB->pid);
+  return rPCB;
 }
 
-/******************** findCvarWaiter ********************/
+/******************** unqueue ********************/
 /*
- * find a waiter in the blocked sync queue corresponding to
- * a cvar id
+ * take a pcb off whatever queue it's on
  *
  * input:
- *  int id - cvar id to search for
- *
- * output:
- *  return pcb of waiter if found
- *  return 1 if found
+ *  pcb - pcb to unlink (nothing happens if it's on no queue)
  *
  */
-pcb_t*
-findCvarWaiter(int id)
+void
+unqueue(pcb_t* pcb)
 {
-  TracePrintf(5, "ENTER findCvarWaiter\n");
+  pcbQueue_t* queue = pcb->queue;
+  if (queue == NULL){
+    return;
+  }
 
-  pcb_t** queue_p = &(processes->blockedSync);
-  if (queue_p == NULL || *queue_p == NULL){
-    TracePrintf(5, "EXIT findCvarWaiter (not found)\n");
-    return NULL;
+  if (pcb->prev != NULL){
+    pcb->prev->next = pcb->next;
+  } else {
+    queue->head = pcb->next;
   }
 
-  //search through items in queue, return first one waiting on cvar 
-  pcb_t* ptr = *(queue_p); 
-  while (ptr != NULL){
-    if (ptr->cvarID == id){
-      TracePrintf(5, "EXIT findCvarWaiter (found proc %d waiting for cvar %d)\n", ptr->pid, id);
-      return ptr;
-    }
-    ptr = ptr->next;
+  if (pcb->next != NULL){
+    pcb->next->prev = pcb->prev;
+  } else {
+    queue->tail = pcb->prev;
   }
 
-  TracePrintf(5, "EXIT findCvarWaiter (not found)\n");
-  return NULL;
+  queue->count--;
+  pcb->next = NULL;
+  pcb->prev = NULL;
+  pcb->queue = NULL;
 }
 
-/******************** findPipeWaiter ********************/
+/******************** waitEnqueue ********************/
 /*
- * find a waiter in the blocked sync queue corresponding to
- * a pipe id
+ * add a pcb to the back of an object's wait queue
  *
  * input:
- *  int id - pipe id to search for
+ *  waiters - wait queue of a lock, cvar, pipe or tty
+ *  pcb - pcb to add (taken off any wait queue it's already on)
  *
- * output:
- *  return pcb of waiter if found
- *  return 1 if found
+ */
+void
+waitEnqueue(pcbQueue_t* waiters, pcb_t* pcb)
+{
+  waitUnqueue(pcb);
+
+  pcb->waitNext = NULL;
+  pcb->waitPrev = waiters->tail;
+  if (waiters->tail != NULL){
+    waiters->tail->waitNext = pcb;
+  } else {
+    waiters->head = pcb;
+  }
+  waiters->tail = pcb;
+  waiters->count++;
+  pcb->waitQueue = waiters;
+}
+
+/******************** waitUnqueue ********************/
+/*
+ * take a pcb off whatever wait queue it's on
+ *
+ * input:
+ *  pcb - pcb to take off (nothing happens if it's on none)
  *
  */
-pcb_t*
-findPipeWaiter(int id)
+void
+waitUnqueue(pcb_t* pcb)
 {
-  TracePrintf(5, "ENTER findPipeWaiter\n");
+  pcbQueue_t* waiters = pcb->waitQueue;
+  if (waiters == NULL){
+    return;
+  }
 
-  pcb_t** queue_p = &(processes->blockedSync);
-  if (queue_p == NULL || *queue_p == NULL) {
-    TracePrintf(5, "EXIT findPipeWaiter (not found)\n");
-    return NULL;
+  if (pcb->waitPrev != NULL){
+    pcb->waitPrev->waitNext = pcb->waitNext;
+  } else {
+    waiters->head = pcb->waitNext;
   }
 
-  //search through items in queue, return first one waiting on pipe 
-  pcb_t* ptr = *queue_p;
-  while (ptr != NULL) {
-    if (ptr->pipeID == id) {
-      TracePrintf(5, "EXIT findPipeWaiter (found proc %d waiting for pipe %d)\n", ptr->pid, id);
-      return ptr;
-    }
-    ptr = ptr->next;
+  if (pcb->waitNext != NULL){
+    pcb->waitNext->waitPrev = pcb->waitPrev;
+  } else {
+    waiters->tail = pcb->waitPrev;
   }
-  TracePrintf(5, "EXIT findPipeWaiter (not found)\n");
-  return NULL;
+
+  waiters->count--;
+  pcb->waitNext = NULL;
+  pcb->waitPrev = NULL;
+  pcb->waitQueue = NULL;
 }
@@ -12,6 +12,7 @@
 #include "memory.h"
 #include "structs.h"
 #include "codes.h"
+#include "clockstats.h"
 
 /***************** coord_initProcesses *****************/
 /*
@@ -71,6 +72,92 @@ void coord_scheduleProcess();
 
 //-------------------------------------------------------
 
+/***************** coord_setPolicy *****************/
+/*
+ * pick the scheduler (done once at boot)
+ *
+ * input: 
+ *  int policy - SCHED_RR or SCHED_MLFQ (see codes.h)
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if not a policy
+ *
+ */
+
+//-------------------------------------------------------
+
+int coord_setPolicy(int policy);
+
+//-------------------------------------------------------
+
+/***************** coord_clockTick *****************/
+/*
+ * let the scheduler take the cpu on a clock tick
+ *
+ * notes:
+ *  round robin always switches (coord_scheduleProcess).
+ *  mlfq charges the tick to the running process and only
+ *  switches when its slice at its level is used up (it's
+ *  demoted a level) or someone at a higher level is ready.
+ *  slices are MLFQ_BASE_SLICE ticks doubled per level down,
+ *  waiting on a terminal or pipe promotes a level
+ *  (coord_promote), and every
+ *  MLFQ_BOOST_INTERVAL ticks everyone goes back to level 0
+ *
+ */
+
+//-------------------------------------------------------
+
+void coord_clockTick();
+
+//-------------------------------------------------------
+
+/***************** coord_promote *****************/
+/*
+ * move a process up an mlfq level (and give it a fresh
+ *  slice) for giving up the cpu to wait on a user
+ *
+ * input: 
+ *  pcb_t* pcb - process about to block
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  only called where a process waits on terminal input or
+ *  on the other end of a pipe, so cpu bound processes don't
+ *  climb back up by faulting pages in or writing output.
+ *  does nothing under round robin
+ *
+ */
+
+//-------------------------------------------------------
+
+void coord_promote(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/***************** coord_getStats *****************/
+/*
+ * report scheduler stats
+ *
+ * input: 
+ *  int* stats - filled in at CLOCKSTAT_POLICY, CLOCKSTAT_LEVEL
+ *   (of the running process), CLOCKSTAT_DEMOTIONS,
+ *   CLOCKSTAT_PROMOTIONS and CLOCKSTAT_BOOSTS (see clockstats.h)
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void coord_getStats(int* stats);
+
+//-------------------------------------------------------
+
 /***************** coord_setRunningProcess *****************/
 /*
  * place process on running spot
@@ -115,7 +202,7 @@ pcb_t* coord_getRunningProcess();
 
 /***************** coord_addProcess *****************/
 /*
- * add process to specific queue
+ * add process to the back of a specific queue
  *
  * input: 
  *  pcb_t* proc - pcb to add to queue
@@ -125,6 +212,9 @@ pcb_t* coord_getRunningProcess();
  *  return 0 on successful add
  *  return ERROR if failed
  *
+ * notes:
+ *  a process already on another queue is moved off it first
+ *
  */
 
 //-------------------------------------------------------
@@ -157,28 +247,28 @@ pcb_t* coord_getProcess(int status);
  * remove a specific process from a queue 
  *
  * input: 
- *  int pid - pid of specific process to remove
+ *  pcb_t* pcb - process to remove
  *  int status - code of which queue
  *
  * output:
  *  return 1 if found and removed
- *  return 0 if not found
- *  return ERROR if found and error removing
+ *  return 0 if not on that queue
+ *  return ERROR if invalid status passed
  *
  */
 
 //-------------------------------------------------------
 
-int coord_removeProcess(int pid, int status);
+int coord_removeProcess(pcb_t* pcb, int status);
 
 //-------------------------------------------------------
 
 /***************** coord_containsProcess *****************/
 /*
- * checks if a given process exists in specific queue
+ * checks if a given process is on a specific queue
  *
  * input: 
- *  int pid - pid of specific process
+ *  pcb_t* pcb - specific process
  *  int status - code of which queue
  *
  * output:
@@ -190,69 +280,95 @@ int coord_removeProcess(int pid, int status);
 
 //-------------------------------------------------------
 
-int coord_containsProcess(int pid, int status);
+int coord_containsProcess(pcb_t* pcb, int status);
 
 //-------------------------------------------------------
 
-/***************** coord_findSyncWaiter *****************/
+/***************** coord_blockOn *****************/
 /*
- * checks for anyone processes waiting on a specific
- *  sync object
+ * block a process on a lock, cvar, pipe or tty: it goes on
+ *  the blocked queue for its state and at the back of the
+ *  object's own wait queue
  *
  * input: 
- *  int id - id of sync object 
- *  int type - code of which type object (lock, pipe, cvar) 
+ *  pcb_t* pcb - process to block (usually the running one,
+ *   which then calls coord_scheduleProcess)
+ *  pcbQueue_t* waiters - the object's wait queue
+ *  int status - code of the blocked queue (BLOCKEDSYNC, BLOCKEDIO)
  *
  * output:
- *  return pcb_t* of first waiter on queue
- *  return NULL if no one blocked waiting
+ *  return 0 on success
+ *  return ERROR if status isn't a blocked queue
+ *
+ * notes:
+ *  moving to any other queue (waking, aborting) takes it off
+ *   the wait queue too
  *
  */
 
 //-------------------------------------------------------
 
-pcb_t* coord_findSyncWaiter(int id, int type);
+int coord_blockOn(pcb_t* pcb, pcbQueue_t* waiters, int status);
 
 //-------------------------------------------------------
 
-/***************** coord_findTtyReadWaiter *****************/
+/***************** coord_getWaiter *****************/
 /*
- * checks for anyone processes waiting on a specific
- *  tty object
+ * take the first process off an object's wait queue without
+ *  waking it (it stays blocked, e.g. to be aborted)
  *
  * input: 
- *  int id - id of tty object 
+ *  pcbQueue_t* waiters - the object's wait queue
  *
  * output:
- *  return pcb_t* of correct waiter on queue
- *  return NULL if no one blocked waiting
+ *  return pcb_t* of first waiter
+ *  return NULL if no one is waiting
  *
  */
 
 //-------------------------------------------------------
 
-pcb_t* coord_findTtyReadWaiter(int tty_id);
+pcb_t* coord_getWaiter(pcbQueue_t* waiters);
+
+//-------------------------------------------------------
 
-/***************** coord_findTtyWriteWaiter *****************/
+/***************** coord_wakeOne *****************/
 /*
- * checks for anyone processes waiting on a specific
- *  tty object
+ * move the first process waiting on an object to ready
  *
  * input: 
- *  int id - id of tty object 
+ *  pcbQueue_t* waiters - the object's wait queue
  *
  * output:
- *  return pcb_t* of correct waiter on queue
- *  return NULL if no one blocked waiting
+ *  return pcb_t* of waiter woken
+ *  return NULL if no one is waiting
  *
  */
 
 //-------------------------------------------------------
 
-pcb_t* coord_findTtyWriteWaiter(int tty_id);
+pcb_t* coord_wakeOne(pcbQueue_t* waiters);
+
+//-------------------------------------------------------
+
+/***************** coord_wakeAll *****************/
+/*
+ * move every process waiting on an object to ready (in the
+ *  order they started waiting)
+ *
+ * input: 
+ *  pcbQueue_t* waiters - the object's wait queue
+ *
+ * output:
+ *  return number woken
+ *
+ */
 
 //-------------------------------------------------------
 
+int coord_wakeAll(pcbQueue_t* waiters);
+
+//-------------------------------------------------------
 
 /***************** coord_addChild *****************/
 /*
@@ -283,9 +399,11 @@ int coord_addChild(pcb_t* parent, pcb_t* child);
  *  int pid - pid of child to remove 
  *
  * output:
- *  return 1 if successfully removed
- *  return 0 if not found 
- *  return ERROR if failed
+ *  return 0 if successfully removed
+ *  return ERROR if pid isn't a child of parent
+ *
+ * notes:
+ *  O(1), the child is found through the process table
  *
  */
 
@@ -295,23 +413,22 @@ int coord_removeChild(pcb_t* parent, int pid);
 
 //-------------------------------------------------------
 
-/***************** coord_killZombieChildren *****************/
+/***************** coord_orphanChildren *****************/
 /*
- * clean up all children of a parent waiting in the zombie queue
- * and finish aborting them
+ * cut a parent off from its children: live children lose
+ * their parent, exit records of dead ones are thrown away
  *
  * input: 
- *  pcb_t* parent - parent process to clean zombie children from
+ *  pcb_t* parent - parent process that's exiting
  *
  * output:
- *  return 0 if successfully killed all zombie children 
- *  return ERROR if failed
+ *  none
  *
  */
 
 //-------------------------------------------------------
 
-int coord_killZombieChildren(pcb_t* parent);
+void coord_orphanChildren(pcb_t* parent);
 
 //-------------------------------------------------------
 
@@ -352,6 +469,104 @@ pcb_t* coord_getIdlePCB();
 
 //-------------------------------------------------------
 
+/***************** coord_listProcesses *****************/
+/*
+ * gather every live process (from the process table, idle
+ *  and dying ones left out) in pid order
+ *
+ * input: 
+ *  procs - filled with the processes
+ *  max - most processes procs holds
+ *
+ * output:
+ *  return number of processes put in procs
+ *
+ */
+
+//-------------------------------------------------------
+
+int coord_listProcesses(pcb_t** procs, int max);
+
+//-------------------------------------------------------
+
+/***************** coord_registerProcess *****************/
+/*
+ * add a process to the process table once it has a pid
+ *
+ * input: 
+ *  pcb_t* pcb - process to add
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void coord_registerProcess(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/***************** coord_unregisterProcess *****************/
+/*
+ * take a process out of the process table (when its pid is
+ *  retired)
+ *
+ * input: 
+ *  pcb_t* pcb - process to take out (nothing happens if it
+ *   was never added)
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void coord_unregisterProcess(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/***************** coord_findProcess *****************/
+/*
+ * look a process up by pid
+ *
+ * input: 
+ *  int pid - pid to find
+ *
+ * output:
+ *  return pcb_t* of process (dead ones too til they're freed)
+ *  return NULL if no such pid
+ *
+ */
+
+//-------------------------------------------------------
+
+pcb_t* coord_findProcess(int pid);
+
+//-------------------------------------------------------
+
+/***************** coord_getState *****************/
+/*
+ * state a process is in
+ *
+ * input: 
+ *  pcb_t* pcb - process to check
+ *
+ * output:
+ *  return RUNNING, ZOMBIE (aborted but not freed yet) or the
+ *   code of the queue it's on
+ *  return ERROR if it's on none (idle while something else
+ *   runs, or a forked child not queued yet)
+ *
+ */
+
+//-------------------------------------------------------
+
+int coord_getState(pcb_t* pcb);
+
+//-------------------------------------------------------
+
 /******************* coord_abort **********************/
 /*
  * exit a process depending on if their parent is
@@ -367,9 +582,11 @@ pcb_t* coord_getIdlePCB();
  *
  * notes:
  *  two types of abortion:
- *  1. parent still alive (place on zombie queue, full
- *    abort later)
+ *  1. parent still alive (parent gets an exit record
+ *    with pid and status, the rest is freed)
  *  2. parent doesn't exist (fully clean up)
+ *  either way the process goes on the reclaim list and
+ *  its memory is freed later (see mem_drainReclaim)
  *
  */
 
@@ -0,0 +1,304 @@
+/*
+ * file: dedup.c
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  scans user pages while idle, merging pages with the same
+ *  contents (in any processes) into one copy on write frame
+ */
+
+#include <ykernel.h>
+#include "dedup.h"
+#include "memory.h"
+#include "codes.h"
+#include "structs.h"
+#include "coordination.h"
+
+/***************** globals *****************/
+dedupEntry_t dedupTable[DEDUP_TABLE_SIZE]; //one page remembered per hash bucket
+int scanPid; //scanner resumes at this process and page
+int scanPage;
+int dedupScanned; //pages hashed
+int dedupMerged; //pages pointed at another frame
+int dedupZeroMerged; //of those, pages folded into the zero frame
+int dedupSaved; //frames freed by merging
+
+/******************* local funcs *******************/
+int isMergeable(pcb_t* pcb, int page);
+unsigned int hashFrame(int frame, int* isZero);
+int sameFrames(int frame1, int frame2);
+pcb_t* findOwner(pcb_t** procs, int numProcs, int pid);
+
+/***************** dedup_init *****************/
+/*
+ * see dedup.h for description
+ */
+void
+dedup_init()
+{
+  TracePrintf(5, "ENTER dedup_init\n");
+
+  for (int i = 0; i < DEDUP_TABLE_SIZE; i++){
+    dedupTable[i].frame = ERROR;
+  }
+  scanPid = 0;
+  scanPage = 0;
+
+  TracePrintf(5, "EXIT dedup_init\n");
+}
+
+/***************** dedup_scan *****************/
+/*
+ * see dedup.h for description
+ */
+int
+dedup_scan(int budget)
+{
+  TracePrintf(8, "ENTER dedup_scan\n");
+
+  if (budget <= 0){
+    return 0;
+  }
+
+  pcb_t* procs[MAX_PROCS];
+  int numProcs = coord_listProcesses(procs, MAX_PROCS);
+
+  //pinned processes may be blocked in a call that writes to a buffer it already
+  //checked was writable, only Delay is known not to
+  int kept = 0;
+  for (int i = 0; i < numProcs; i++){
+    if (procs[i]->pt != NULL && (!procs[i]->pinned || coord_containsProcess(procs[i], BLOCKEDDELAY) == 1)){
+      procs[kept++] = procs[i];
+    }
+  }
+  numProcs = kept;
+  if (numProcs == 0){
+    return 0;
+  }
+
+  //pick up where the scanner left off
+  int start = 0;
+  while (start < numProcs && procs[start]->pid < scanPid){
+    start++;
+  }
+  int startPos = 0;
+  if (start < numProcs){
+    startPos = start * MAX_PT_LEN;
+    if (procs[start]->pid == scanPid){
+      startPos += scanPage;
+    }
+  }
+
+  //at most one trip over everyone's pages
+  int positions = numProcs * MAX_PT_LEN;
+  int hashed = 0;
+  int merged = 0;
+  int i;
+  for (i = 0; i < positions && hashed < budget; i++){
+    int pos = (startPos + i) % positions;
+    pcb_t* pcb = procs[pos / MAX_PT_LEN];
+    int page = pos % MAX_PT_LEN;
+
+    if (!isMergeable(pcb, page)){
+      continue;
+    }
+
+    int frame = pcb->pt[page].pfn;
+    int isZero;
+    unsigned int hash = hashFrame(frame, &isZero);
+    hashed++;
+    dedupScanned++;
+
+    //written but still all zeros, back onto the zero frame
+    if (isZero){
+      dedupSaved += mem_mergePage(NULL, 0, pcb, page);
+      dedupMerged++;
+      dedupZeroMerged++;
+      merged++;
+      continue;
+    }
+
+    //same hash seen before, check its page is still there and really matches
+    dedupEntry_t* entry = &dedupTable[hash % DEDUP_TABLE_SIZE];
+    if (entry->frame != ERROR && entry->hash == hash && entry->frame != frame){
+      pcb_t* owner = findOwner(procs, numProcs, entry->pid);
+      if (owner != NULL && isMergeable(owner, entry->page) && owner->pt[entry->page].pfn == entry->frame
+          && sameFrames(entry->frame, frame)){
+        dedupSaved += mem_mergePage(owner, entry->page, pcb, page);
+        dedupMerged++;
+        merged++;
+        continue;
+      }
+    }
+
+    //remember this page for later ones to match against
+    entry->hash = hash;
+    entry->frame = frame;
+    entry->pid = pcb->pid;
+    entry->page = page;
+  }
+
+  //next call starts after the last page looked at
+  int next = (startPos + i) % positions;
+  scanPid = procs[next / MAX_PT_LEN]->pid;
+  scanPage = next % MAX_PT_LEN;
+
+  TracePrintf(8, "EXIT dedup_scan (%d hashed, %d merged)\n", hashed, merged);
+  return merged;
+}
+
+/***************** dedup_getStats *****************/
+/*
+ * see dedup.h for description
+ */
+void
+dedup_getStats(int* scanned, int* merged, int* saved)
+{
+  *scanned = dedupScanned;
+  *merged = dedupMerged;
+  *saved = dedupSaved;
+}
+
+/***************** dedup_exit *****************/
+/*
+ * see dedup.h for description
+ */
+void
+dedup_exit()
+{
+  TracePrintf(1, "dedup: %d pages scanned, %d merged (%d into the zero frame), %d frames saved\n",
+      dedupScanned, dedupMerged, dedupZeroMerged, dedupSaved);
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** isMergeable ********************/
+/*
+ * whether a page can be merged. only resident data, heap
+ *  and stack pages
+ *
+ * input:
+ *  pcb - process owning the page
+ *  page - region 1 page
+ *
+ * output:
+ *  return 1 if page can be merged
+ *  return 0 if not
+ *
+ */
+int
+isMergeable(pcb_t* pcb, int page)
+{
+  if (pcb->pt[page].valid == 0){
+    return 0;
+  }
+
+  //shared segments are meant to be written by everyone, zero pages already are merged,
+  //and sampled pages have their protection parked elsewhere for the moment
+  if (pcb->pageFlags[page] & (PAGE_SHARED | PAGE_ZERO | PAGE_SAMPLED)){
+    return 0;
+  }
+
+  vma_t* vma = mem_findVMA(pcb, page);
+  if (vma == NULL){
+    return 0;
+  }
+
+  return vma->type == VMA_DATA || vma->type == VMA_HEAP || vma->type == VMA_STACK;
+}
+
+/******************** hashFrame ********************/
+/*
+ * hash the contents of a frame (fnv-1a over its words)
+ *
+ * input:
+ *  frame - frame to hash
+ *  isZero - set to 1 if every byte is zero, 0 if not
+ *
+ * output:
+ *  return the hash
+ *
+ */
+unsigned int
+hashFrame(int frame, int* isZero)
+{
+  unsigned int* words = mem_mapWindow(&frame, 1);
+  unsigned int hash = 2166136261u;
+  unsigned int bits = 0;
+
+  for (int i = 0; i < PAGESIZE / sizeof(unsigned int); i++){
+    hash = (hash ^ words[i]) * 16777619u;
+    bits |= words[i];
+  }
+  mem_unmapWindow(1);
+
+  *isZero = (bits == 0);
+  return hash;
+}
+
+/******************** sameFrames ********************/
+/*
+ * compare the contents of two frames
+ *
+ * input:
+ *  frame1, frame2 - frames to compare
+ *
+ * output:
+ *  return 1 if every byte matches
+ *  return 0 if not
+ *
+ */
+int
+sameFrames(int frame1, int frame2)
+{
+  int pair[2] = {frame1, frame2};
+  unsigned int* words = mem_mapWindow(pair, 2);
+  int wordsPerPage = PAGESIZE / sizeof(unsigned int);
+
+  int same = 1;
+  for (int i = 0; i < wordsPerPage; i++){
+    if (words[i] != words[wordsPerPage + i]){
+      same = 0;
+      break;
+    }
+  }
+  mem_unmapWindow(2);
+
+  return same;
+}
+
+/******************** findOwner ********************/
+/*
+ * find a process by pid in a pid ordered list
+ *
+ * input:
+ *  procs - processes from coord_listProcesses
+ *  numProcs - number in procs
+ *  pid - pid to look for
+ *
+ * output:
+ *  return the process
+ *  return NULL if it's gone
+ *
+ */
+pcb_t*
+findOwner(pcb_t** procs, int numProcs, int pid)
+{
+  int low = 0;
+  int high = numProcs - 1;
+  while (low <= high){
+    int mid = (low + high) / 2;
+    if (procs[mid]->pid == pid){
+      return procs[mid];
+    }
+    if (procs[mid]->pid < pid){
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,97 @@
+/*
+ * file: dedup.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  interface for dedup.c (merging identical user pages)
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <ykernel.h>
+#include "codes.h"
+#include "structs.h"
+
+/********************* dedup_init *********************/
+/*
+ * start with an empty hash table and the scanner at the
+ *  first process
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void dedup_init();
+
+//-------------------------------------------------------
+
+/********************* dedup_scan *********************/
+/*
+ * hash the next few user pages, merging any that match a
+ *  page seen before into one copy on write frame
+ *
+ * input: 
+ *  budget - most pages to hash
+ *
+ * output:
+ *  return number of pages merged
+ *
+ * notes:
+ *  only call while idle is running, merging edits other
+ *   processes' page tables and relies on the tlb flush when
+ *   they're switched back in
+ *
+ */
+
+//-------------------------------------------------------
+
+int dedup_scan(int budget);
+
+//-------------------------------------------------------
+
+/********************* dedup_getStats *********************/
+/*
+ * get dedup scanner stats
+ *
+ * input: 
+ *  scanned - set to pages hashed
+ *  merged - set to pages merged into another frame
+ *  saved - set to frames freed by merging
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void dedup_getStats(int* scanned, int* merged, int* saved);
+
+//-------------------------------------------------------
+
+/********************* dedup_exit *********************/
+/*
+ * report dedup stats on the way down
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void dedup_exit();
+
+//-------------------------------------------------------
+
+#endif
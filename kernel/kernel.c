@@ -13,6 +13,10 @@
 #include "loadprogram.h"
 #include "codes.h"
 #include "sync.h"
+#include "swap.h"
+#include "dedup.h"
+#include "zcache.h"
+#include "slab.h"
 
 #define MAX_FILE_LEN 128
 
@@ -70,6 +74,17 @@ KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* uc)
   vmemEnable = 1;
   WriteRegister(REG_VM_ENABLE, 1);
 
+  rc = mem_initZeroFrame();
+  if (rc == ERROR){
+    TracePrintf(0, "Failed to init zero frame, HALTING\n");
+    Halt();
+  }
+
+  swap_init();
+  zcache_init();
+  dedup_init();
+  slab_init();
+
 
   rc = coord_initProcesses();
   if (rc == ERROR){
@@ -83,6 +98,20 @@ KernelStart(char** cmd_args, unsigned int pmem_size, UserContext* uc)
     Halt();
   }
   
+  //scheduler option comes ahead of the program to run ("sched=rr" or "sched=mlfq")
+  int policy = SCHED_DEFAULT;
+  if (cmd_args != NULL && cmd_args[0] != NULL && strncmp(cmd_args[0], "sched=", 6) == 0){
+    if (strcmp(cmd_args[0] + 6, "mlfq") == 0){
+      policy = SCHED_MLFQ;
+    } else if (strcmp(cmd_args[0] + 6, "rr") == 0){
+      policy = SCHED_RR;
+    } else {
+      TracePrintf(0, "Unknown scheduler '%s', using the default\n", cmd_args[0] + 6);
+    }
+    cmd_args++;
+  }
+  coord_setPolicy(policy);
+
   //collect arg[0] from user (initial process to run)
   char* file = calloc(sizeof(char), MAX_FILE_LEN);
   if (file == NULL){
@@ -148,9 +177,9 @@ SetKernelBrk(void* addr)
   u_long addrInt = (u_long) addr;
   int addrPage = addrInt >> PAGESHIFT;
 
-  //make sure addr isn't encroaching on stack
+  //make sure addr isn't encroaching on stack (or the copy window under it)
   int firstStackPage = (KERNEL_STACK_BASE >> PAGESHIFT);
-  if (addrPage >= firstStackPage - 1){
+  if (addrPage >= firstStackPage - COPY_WINDOW_SLOTS){
     TracePrintf(0, "Kernel heap creeping into stack\n");
     return ERROR;
   }
@@ -165,8 +194,10 @@ SetKernelBrk(void* addr)
         
         //set all pages beyond brk we now need to a frame
         for(int page = kBrk; page < addrPage; page++){
+          mem_addKernelHeapFrames(1);
           if (mem_useFrame(page) == ERROR){
             TracePrintf(0, "brk increassing before vmem enabled but page so pfn = vpn is taken");
+            mem_addKernelHeapFrames(-1);
             return ERROR;
           }
           pt[page].pfn = page;
@@ -192,9 +223,11 @@ SetKernelBrk(void* addr)
 
       //set all pages beyond brk we now need to a frame
       for(int page = kBrk; page < addrPage; page++){
+        mem_addKernelHeapFrames(1);
         int frame = mem_getFreeFrame();
         if (frame == ERROR){
           TracePrintf(0, "Out of free frames in SetKernelBrk\n");
+          mem_addKernelHeapFrames(-1);
           return ERROR;
         }
 
@@ -230,22 +263,19 @@ initProcess(UserContext** ucp, char* file, char** args)
   TracePrintf(5, "ENTER initProcess\n");
   UserContext* uc = *ucp;
 
-  pcb_t* pcb = malloc(sizeof(pcb_t));
+  pcb_t* pcb = slab_alloc(&pcbCache);
   if (pcb == NULL){
     TracePrintf(0, "failed to alloc space for init pcb\n");
     return ERROR;
   }
-  memset(pcb, 0, sizeof(pcb_t));
 
   //initialize fields of pcb
   pte_t* pt = mem_initUserPT();
   pcb->pt = pt;
   pcb->pid = helper_new_pid(pcb->pt);
-  pcb->wakeTime = 0;
   pcb->abort = 0;
   pcb->children = NULL;
-  pcb->ttyReadWaiting = -1;
-  pcb->ttyWriteWaiting = -1;
+  coord_registerProcess(pcb);
 
 
   //assign stack frames
@@ -261,7 +291,7 @@ initProcess(UserContext** ucp, char* file, char** args)
 
   //load initial program file into pcb
   int rc = LoadProgram(file, args, pcb);
-  if (rc == ERROR){
+  if (rc != SUCCESS){
     TracePrintf(0, "Failed to load program\n");
     return ERROR;
   }
@@ -292,7 +322,7 @@ idleProcess(UserContext** ucp)
   UserContext* uc = *ucp;
 
 
-  pcb_t* pcb = malloc(sizeof(pcb_t));  
+  pcb_t* pcb = slab_alloc(&pcbCache);
   if (pcb == NULL){
     TracePrintf(0, "failed to alloc space for init pcb\n");
     return ERROR;
@@ -307,12 +337,14 @@ idleProcess(UserContext** ucp)
   pcb->pt = pt;
   pcb->pid = helper_new_pid(pt);
   mem_initUserStack(pt); 
+  mem_addVMA(pcb, VMA_STACK, MAX_PT_LEN - 1, 1, (PROT_READ | PROT_WRITE));
   
   //set pcb for abort status
   pcb->abort = 0;
 
   //save this pcb as the idle process
   coord_setIdlePCB(pcb);
+  coord_registerProcess(pcb);
 
   //copy the current rernel context into pcb
   int rc = KernelContextSwitch(KCCopy, pcb, NULL);
@@ -343,6 +375,10 @@ idleProcess(UserContext** ucp)
  * loop and print idle (runs when no one else
  * is available)
  *
+ * notes:
+ *  runs in user mode, so the clock handler does the
+ *  idle time work (zero pool) on its behalf
+ *
  */
 void
 doIdle()
@@ -7,11 +7,23 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <ykernel.h>
 #include <load_info.h>
 
 #include "memory.h"
 #include "structs.h"
+#include "loadprogram.h"
+#include "swap.h"
+#include "shm.h"
+
+/******************** globals ********************/
+image_t* imageCache = NULL; //every program exec'd so far (see structs.h)
+
+/******************* local funcs *******************/
+image_t* AcquireImage(char* name, int fd, struct load_info* li);
+void DestroyImage(image_t* image);
+int ReadPage(pcb_t* proc, int page, int frame);
 
 /*
  * ==>> #include anything you need for your kernel here
@@ -47,7 +59,6 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   int data_pg1;
   int data_npg;
   int stack_npg;
-  long segment_size;
   char *argbuf;
 
   
@@ -138,6 +149,30 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
     return ERROR;
   }
 
+  //make sure there are enough frames before we throw away the old address space
+  //(the old region 1 frames come back to us, and others can be paged out, so count them as available)
+  //(when loading lazily only the stack needs frames up front)
+  int need_frames = LAZY_LOAD ? stack_npg : li.t_npg + li.id_npg + stack_npg;
+  int other_frames = swap_getFreeSlotCount();
+  for (int v = 0; v < proc->numVmas; v++){
+    vma_t* vma = &(proc->vmas[v]);
+    for (int page = vma->firstPage; page < vma->firstPage + vma->numPages; page++){
+      if (proc->pt[page].valid == 1){
+        other_frames++;
+      }
+    }
+  }
+  if (need_frames > mem_getFreeFrameCount() + other_frames) {
+    //dead processes and programs no one is running still hold frames, give those back first
+    mem_drainReclaim(MAX_PROCS);
+    PurgeImages();
+  }
+  if (need_frames > mem_getFreeFrameCount() + other_frames) {
+    TracePrintf(1, "LoadProgram: not enough free frames for '%s'\n", name);
+    close(fd);
+    return ERROR;
+  }
+
   /*
    * This completes all the checks before we proceed to actually load
    * the new program.  From this point on, we are committed to either
@@ -161,6 +196,7 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   cp2 = argbuf = (char *)malloc(size);
   if (cp2 == NULL){
     TracePrintf(1, "In LoadProgram, malloc for cp2 failed\n");
+    close(fd);
     return ERROR;
   }
 
@@ -168,6 +204,14 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
    * ==>> You should perhaps check that malloc returned valid space 
    */
 
+  //find (or start) the cached image of this program, it takes over fd
+  image_t* image = AcquireImage(name, fd, &li);
+  if (image == NULL){
+    TracePrintf(1, "In LoadProgram, couldn't get image for '%s'\n", name);
+    free(argbuf);
+    return ERROR;
+  }
+
   for (i = 0; args[i] != NULL; i++) {
     TracePrintf(3, "saving arg %d = '%s'\n", i, args[i]);
     strcpy(cp2, args[i]);
@@ -185,14 +229,15 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
    * ==>> for every valid page, free the pfn and mark the page invalid.
    */
 
+  //shared segments don't survive exec
+  shm_detachAll(proc);
+
   pte_t* pt = (pte_t*)proc->pt;
-  for (int page = 0; page < MAX_PT_LEN; page++){
-    if (pt[page].valid == 1){
-      mem_freeFrame(pt[page].pfn);
-      pt[page].pfn = -1;
-      pt[page].valid = 0;
-    }
-  }
+  mem_freeRegions(proc);
+
+  //done with the file the old address space came from
+  ReleaseImage(proc->image);
+  proc->image = NULL;
 
   /*
    * ==>> Then, build up the new region1.  
@@ -204,40 +249,12 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
    * ==>> the "text_pg1" page in region 1 address space.
    * ==>> These pages should be marked valid, with a protection of
    * ==>> (PROT_READ | PROT_WRITE).
-   */
-
-  for (int page = text_pg1; page < text_pg1 + li.t_npg; page++){
-    int frame = mem_getFreeFrame();
-    if (frame == ERROR) 
-      return ERROR;
-
-    pt[page].valid = 1;
-    pt[page].pfn = frame;
-    pt[page].prot = (PROT_READ | PROT_WRITE);
-  }
-
-  /*
+   *
    * ==>> Then, data. Allocate "data_npg" physical pages and map them starting at
    * ==>> the  "data_pg1" in region 1 address space.
    * ==>> These pages should be marked valid, with a protection of
    * ==>> (PROT_READ | PROT_WRITE).
-   */
-  for (int page = data_pg1; page < data_pg1 + data_npg; page++){
-    int frame = mem_getFreeFrame();
-    if (frame == ERROR) 
-      return ERROR;
-
-    pt[page].valid = 1;
-    pt[page].pfn = frame;
-    pt[page].prot = (PROT_READ | PROT_WRITE);
-  }
-
-  //initializing brk  ISAAC WROTE THUS
-  //does this leave a page between heap and stack??? -jack
-  proc->brk = data_pg1 + data_npg;
-  proc->minBrk = data_pg1 + data_npg;
-
-  /* 
+   *
    * ==>> Then, stack. Allocate "stack_npg" physical pages and map them to the top
    * ==>> of the region 1 virtual address space.
    * ==>> These pages should be marked valid, with a
@@ -245,79 +262,86 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
    */
 
   int stack_pg1 = MAX_PT_LEN - stack_npg;
-  for (int page = stack_pg1; page < MAX_PT_LEN; page++){
-    int frame = mem_getFreeFrame();
-    if (frame == ERROR) 
-      return ERROR;
-    
-    proc->pt[page].valid = 1;
-    proc->pt[page].pfn = frame;
-    proc->pt[page].prot = (PROT_READ | PROT_WRITE);
-  }
-
-  /*
-   * ==>> (Finally, make sure that there are no stale region1 mappings left in the TLB!)
-   */
-  WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
-  
-  /*
-   * All pages for the new address space are now in the page table.  
-   */
 
-  /*
-   * Read the text from the file into memory.
-   */
-  lseek(fd, li.t_faddr, SEEK_SET);
-  segment_size = li.t_npg << PAGESHIFT;
-
-  TracePrintf(1, "Writing pg %d until %d\n", (li.t_vaddr >> PAGESHIFT), (li.t_vaddr >> PAGESHIFT)+ li.t_npg);
-  if (read(fd, (void *) li.t_vaddr, segment_size) != segment_size) {
-    close(fd);
-    return KILL;   // see ykernel.h
+  //loading lazily only the stack gets frames now, text and data are read in by LoadPage.
+  //otherwise get frames for every page we'll read too, so the load can't fail halfway
+  int file_npg = 0;
+  if (!LAZY_LOAD) {
+    file_npg = li.id_npg;
+    for (int page = 0; page < li.t_npg; page++){
+      if (image->textFrames[page] == ERROR){
+        file_npg++;
+      }
+    }
   }
-
-
-  /*
-   * Read the data from the file into memory.
-   */
-  lseek(fd, li.id_faddr, 0);
-  segment_size = li.id_npg << PAGESHIFT;
-
-
-  TracePrintf(1, "Writing pg %d until %d\n", (li.id_vaddr >> PAGESHIFT), (li.id_vaddr >> PAGESHIFT) + li.id_npg);
-  if (read(fd, (void *) li.id_vaddr, segment_size) != segment_size) {
-    close(fd);
+  int* frame_list = malloc(sizeof(int) * (stack_npg + file_npg));
+  if (frame_list == NULL || mem_reserveFrames(frame_list, stack_npg + file_npg) == ERROR) {
+    TracePrintf(0, "LoadProgram: couldn't get %d frames for '%s'\n", stack_npg + file_npg, name);
+    free(frame_list);
+    free(argbuf);
+    ReleaseImage(image);
     return KILL;
   }
+  mem_mapUserPages(pt, stack_pg1, stack_npg, (PROT_READ | PROT_WRITE), frame_list);
 
-  close(fd);			/* we've read it all now */
+  //text pages another process already read in just get mapped,
+  //the rest of text and init data are backed by the file til touched
+  for (int page = text_pg1; page < text_pg1 + li.t_npg; page++){
+    int frame = image->textFrames[page - text_pg1];
+    if (frame != ERROR){
+      mem_shareFrame(frame);
+      mem_mapUserPages(pt, page, 1, (PROT_READ | PROT_EXEC), &frame);
+    } else {
+      proc->pageFlags[page] = PAGE_FILE;
+    }
+  }
+  for (int page = data_pg1; page < data_pg1 + li.id_npg; page++){
+    proc->pageFlags[page] = PAGE_FILE;
+  }
 
+  //whole bss pages are just zeros
+  mem_mapZeroPages(proc, data_pg1 + li.id_npg, li.ud_npg);
+  proc->image = image;
 
-  /*
-   * ==>> Above, you mapped the text pages as writable, so this code could write
-   * ==>> the new text there.
-   *
-   * ==>> But now, you need to change the protections so that the machine can execute
-   * ==>> the text.
-   *
-   * ==>> For each text page in region1, change the protection to (PROT_READ | PROT_EXEC).
-   * ==>> If any of these page table entries is also in the TLB, 
-   * ==>> you will need to flush the old mapping. 
-   */
+  //initializing brk  ISAAC WROTE THUS
+  //does this leave a page between heap and stack??? -jack
+  proc->brk = data_pg1 + data_npg;
+  proc->minBrk = data_pg1 + data_npg;
 
-  for (int page = text_pg1; page < text_pg1 + li.t_npg; page++){
-    proc->pt[page].prot = (PROT_READ | PROT_EXEC);
-  }
+  //regions of the new address space (fresh process, there's room for all four)
+  mem_addVMA(proc, VMA_TEXT, text_pg1, li.t_npg, (PROT_READ | PROT_EXEC));
+  mem_addVMA(proc, VMA_DATA, data_pg1, data_npg, (PROT_READ | PROT_WRITE));
+  mem_addVMA(proc, VMA_HEAP, proc->brk, 0, (PROT_READ | PROT_WRITE));
+  mem_addVMA(proc, VMA_STACK, stack_pg1, stack_npg, (PROT_READ | PROT_WRITE));
 
+  /*
+   * ==>> (Finally, make sure that there are no stale region1 mappings left in the TLB!)
+   */
   WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
   
   /*
-   * Zero out the uninitialized data area
+   * All pages for the new address space are now in the page table.  
    */
-  //ADDED THIS VOID * SO IT COMPILES - JACKCKAJCKAJCKJAKCJAKCJKAJC DI THIS
-  bzero((void*)li.id_end, li.ud_end - li.id_end);
 
+  //not loading lazily, so read text and data in (and zero the bss tail) right now,
+  //into the frames reserved above
+  int next_frame = stack_npg;
+  for (int page = text_pg1; next_frame < stack_npg + file_npg && page < data_pg1 + li.id_npg; page++){
+    if ((proc->pageFlags[page] & PAGE_FILE) == 0){
+      continue;
+    }
+    if (ReadPage(proc, page, frame_list[next_frame++]) == ERROR){
+      mem_releaseFrames(frame_list + next_frame, stack_npg + file_npg - next_frame);
+      free(frame_list);
+      free(argbuf);
+      return KILL;   // see ykernel.h
+    }
+  }
 
+  //text another process read in while we waited for frames got shared instead,
+  //give back the frames that were meant for it
+  mem_releaseFrames(frame_list + next_frame, stack_npg + file_npg - next_frame);
+  free(frame_list);
 
   /*
    * Set the entry point in the process's UserContext
@@ -353,3 +377,289 @@ LoadProgram(char *name, char *args[], pcb_t* proc)
   return SUCCESS;
 }
 
+
+/******************** LoadPage ********************/
+/*
+ * see loadprogram.h for description
+ */
+int
+LoadPage(pcb_t* proc, int page)
+{
+  TracePrintf(5, "ENTER LoadPage (page %d)\n", page);
+
+  image_t* image = proc->image;
+  if (image == NULL || page < 0 || page >= MAX_PT_LEN || (proc->pageFlags[page] & PAGE_FILE) == 0){
+    TracePrintf(3, "LoadPage: page %d not backed by a file\n", page);
+    return ERROR;
+  }
+
+  struct load_info* li = &(image->li);
+  int text_pg1 = (li->t_vaddr - VMEM_1_BASE) >> PAGESHIFT;
+  u_long addr = (page << PAGESHIFT) + VMEM_1_BASE;
+
+  int text_page = (page >= text_pg1 && page < text_pg1 + li->t_npg);
+
+  //another process already read this text page in, just share its frame
+  if (text_page && image->textFrames[page - text_pg1] != ERROR){
+    int frame = image->textFrames[page - text_pg1];
+    mem_shareFrame(frame);
+    mem_mapUserPages(proc->pt, page, 1, (PROT_READ | PROT_EXEC), &frame);
+    proc->pageFlags[page] &= ~PAGE_FILE;
+    WriteRegister(REG_TLB_FLUSH, addr);
+    return 0;
+  }
+
+  int frame = mem_allocFrame();
+  if (frame == ERROR){
+    TracePrintf(1, "LoadPage: no free frame for page %d\n", page);
+    return ERROR;
+  }
+
+  int rc = ReadPage(proc, page, frame);
+
+  TracePrintf(5, "EXIT LoadPage\n");
+  return rc;
+}
+
+/******************** ReleaseImage ********************/
+/*
+ * see loadprogram.h for description
+ */
+void
+ReleaseImage(image_t* image)
+{
+  if (image == NULL){
+    return;
+  }
+
+  //unused images stay cached (til PurgeImages) unless the file changed under them
+  image->refs--;
+  if (image->refs <= 0 && image->stale){
+    DestroyImage(image);
+  }
+}
+
+/******************** PurgeImages ********************/
+/*
+ * see loadprogram.h for description
+ */
+void
+PurgeImages()
+{
+  TracePrintf(5, "ENTER PurgeImages\n");
+
+  image_t* prev = NULL;
+  image_t* image = imageCache;
+  while (image != NULL){
+    image_t* next = image->next;
+
+    //no process running it, drop it and its text frames
+    if (image->refs <= 0){
+      if (prev == NULL){
+        imageCache = next;
+      } else {
+        prev->next = next;
+      }
+      DestroyImage(image);
+    } else {
+      prev = image;
+    }
+
+    image = next;
+  }
+
+  TracePrintf(5, "EXIT PurgeImages\n");
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** AcquireImage ********************/
+/*
+ * find the cached image for a program, or cache a new one
+ *
+ * input:
+ *  name - path the program was exec'd by
+ *  fd - open file of program (image takes it over, closed on failure)
+ *  li - load info already read from fd
+ *
+ * output:
+ *  return image with a hold for the caller
+ *  return NULL on failure
+ *
+ */
+image_t*
+AcquireImage(char* name, int fd, struct load_info* li)
+{
+  struct stat st;
+  if (fstat(fd, &st) < 0){
+    TracePrintf(1, "AcquireImage: can't stat '%s'\n", name);
+    close(fd);
+    return NULL;
+  }
+
+  //look for the same path pointing at the same file
+  image_t* prev = NULL;
+  for (image_t* image = imageCache; image != NULL; prev = image, image = image->next){
+    if (strcmp(image->path, name) != 0){
+      continue;
+    }
+
+    if (image->dev == (unsigned long)st.st_dev && image->ino == (unsigned long)st.st_ino &&
+        image->size == (long)st.st_size && image->mtime == (long)st.st_mtime){
+      TracePrintf(3, "AcquireImage: '%s' already cached\n", name);
+      close(fd);
+      image->refs++;
+      return image;
+    }
+
+    //file changed since it was cached, stop handing out the old image
+    if (prev == NULL){
+      imageCache = image->next;
+    } else {
+      prev->next = image->next;
+    }
+    image->stale = 1;
+    if (image->refs <= 0){
+      DestroyImage(image);
+    }
+    break;
+  }
+
+  image_t* image = malloc(sizeof(image_t));
+  if (image == NULL){
+    TracePrintf(1, "AcquireImage: malloc for image failed\n");
+    close(fd);
+    return NULL;
+  }
+
+  image->path = malloc(strlen(name) + 1);
+  image->textFrames = malloc(sizeof(int) * (li->t_npg + 1));
+  if (image->path == NULL || image->textFrames == NULL){
+    TracePrintf(1, "AcquireImage: malloc for image fields failed\n");
+    free(image->path);
+    free(image->textFrames);
+    free(image);
+    close(fd);
+    return NULL;
+  }
+
+  strcpy(image->path, name);
+  image->dev = (unsigned long)st.st_dev;
+  image->ino = (unsigned long)st.st_ino;
+  image->size = (long)st.st_size;
+  image->mtime = (long)st.st_mtime;
+  image->fd = fd;
+  image->li = *li;
+  for (int page = 0; page < li->t_npg; page++){
+    image->textFrames[page] = ERROR;
+  }
+  image->refs = 1;
+  image->stale = 0;
+
+  image->next = imageCache;
+  imageCache = image;
+
+  return image;
+}
+
+/******************** DestroyImage ********************/
+/*
+ * close an image's file and drop its hold on its text frames
+ *  (image must already be out of the cache)
+ *
+ * input:
+ *  image - image to destroy
+ *
+ * output:
+ *  none
+ *
+ */
+void
+DestroyImage(image_t* image)
+{
+  TracePrintf(5, "DestroyImage: closing '%s'\n", image->path);
+
+  for (int page = 0; page < image->li.t_npg; page++){
+    if (image->textFrames[page] != ERROR){
+      mem_freeFrame(image->textFrames[page]);
+    }
+  }
+
+  close(image->fd);
+  free(image->textFrames);
+  free(image->path);
+  free(image);
+}
+
+/******************** ReadPage ********************/
+/*
+ * read a text or data page in from the program file
+ *  into a frame the caller already has
+ *
+ * input:
+ *  proc - process the page belongs to (must be running process)
+ *  page - region 1 page to read, marked PAGE_FILE
+ *  frame - frame to read it into (freed on failure)
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if the read failed
+ *
+ */
+int
+ReadPage(pcb_t* proc, int page, int frame)
+{
+  image_t* image = proc->image;
+  struct load_info* li = &(image->li);
+  int text_pg1 = (li->t_vaddr - VMEM_1_BASE) >> PAGESHIFT;
+  int data_pg1 = (li->id_vaddr - VMEM_1_BASE) >> PAGESHIFT;
+  u_long addr = (page << PAGESHIFT) + VMEM_1_BASE;
+  int text_page = (page >= text_pg1 && page < text_pg1 + li->t_npg);
+
+  //figure out where in the file the page lives and what it should end up as
+  off_t faddr;
+  u_long prot;
+  if (text_page){
+    faddr = li->t_faddr + ((off_t)(page - text_pg1) << PAGESHIFT);
+    prot = (PROT_READ | PROT_EXEC);
+  } else {
+    faddr = li->id_faddr + ((off_t)(page - data_pg1) << PAGESHIFT);
+    prot = (PROT_READ | PROT_WRITE);
+  }
+
+  //map it writable so we can read the file into it
+  mem_mapUserPages(proc->pt, page, 1, (PROT_READ | PROT_WRITE), &frame);
+  WriteRegister(REG_TLB_FLUSH, addr);
+
+  lseek(image->fd, faddr, SEEK_SET);
+  if (read(image->fd, (void*)addr, PAGESIZE) != PAGESIZE){
+    TracePrintf(1, "ReadPage: failed to read page %d from file\n", page);
+    mem_freePTE(proc->pt, page);
+    WriteRegister(REG_TLB_FLUSH, addr);
+    return ERROR;
+  }
+
+  //zero whatever part of the top init data page belongs to bss
+  if (prot & PROT_WRITE){
+    u_long lo = (addr > li->id_end) ? addr : li->id_end;
+    u_long hi = (addr + PAGESIZE < li->ud_end) ? addr + PAGESIZE : li->ud_end;
+    if (lo < hi){
+      bzero((void*)lo, hi - lo);
+    }
+  }
+
+  proc->pt[page].prot = prot;
+  proc->pageFlags[page] &= ~PAGE_FILE;
+  proc->pageFlags[page] |= PAGE_REF;
+  WriteRegister(REG_TLB_FLUSH, addr);
+
+  //image keeps its own hold on text frames for the next process running the program
+  if (text_page){
+    mem_shareFrame(frame);
+    image->textFrames[page - text_pg1] = frame;
+  }
+
+  return 0;
+}
@@ -6,6 +6,12 @@
  *  holds LoadProgram
  */
 
+#ifndef LOADPROGRAM_H
+#define LOADPROGRAM_H
+
+#include <ykernel.h>
+#include "structs.h"
+
 /******************** LoadProgram ********************/
 /*
  * loads file into user land address space
@@ -29,3 +35,65 @@
 int LoadProgram(char *name, char *args[], pcb_t* proc);
 
 //-------------------------------------------------------
+
+/******************** LoadPage ********************/
+/*
+ * read a lazily loaded text or data page in from the
+ *  program file on first touch
+ *
+ * input:
+ *  proc - process the page belongs to (must be running process)
+ *  page - region 1 page to load
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if page not file backed or load failed
+ *
+ */
+
+//-------------------------------------------------------
+
+int LoadPage(pcb_t* proc, int page);
+
+//-------------------------------------------------------
+
+/******************** ReleaseImage ********************/
+/*
+ * drop a process's hold on the program image it was loaded
+ *  from. unused images stay cached so the next exec of the
+ *  program can map its text frames straight away
+ *
+ * input:
+ *  image - image to release (NULL is fine)
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void ReleaseImage(image_t* image);
+
+//-------------------------------------------------------
+
+/******************** PurgeImages ********************/
+/*
+ * drop every cached program image no process is running,
+ *  closing its file and freeing its text frames
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void PurgeImages();
+
+//-------------------------------------------------------
+
+#endif
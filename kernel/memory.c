@@ -10,17 +10,72 @@
 #include "memory.h"
 #include "structs.h"
 #include "traps.h"
-
-#define BITS_PER_WORD   (sizeof(u_long) * CHAR_BIT) //number of bits in a u_long
+#include "swap.h"
+#include "slab.h"
+#include "shm.h"
+#include "dedup.h"
+#include "zcache.h"
+#include "workset.h"
+#include "timer.h"
+#include "coordination.h"
+#include "loadprogram.h"
+
+#define BITS_PER_WORD   (sizeof(frame_word_t) * CHAR_BIT) //number of bits in a vector
 #define VECTOR_INDEX(n) ((n) / BITS_PER_WORD) //vector in array
 #define FRAME_INDEX(n)  ((n) % BITS_PER_WORD) //frame in vector
-#define BIT_MASK(n)     (1UL << (FRAME_INDEX(n))) // mask for specific bit
+#define BIT_MASK(n)     (((frame_word_t)1) << (FRAME_INDEX(n))) // mask for specific bit
+#define FULL_VECTOR     (~((frame_word_t)0)) //every frame in vector used
+
+typedef unsigned long long frame_word_t; //64 frames per vector
 
 /******************** globals ********************/
-u_long* frames;
+frame_word_t* frames;
 int numFrames;
+int numVectors;
+int freeFrames; //running count of unused frames
+int nextFitVector; //vector to resume searching for a free frame from
+unsigned short* frameRefs; //number of ptes mapping each frame
+int zeroFrame = ERROR; //shared read only frame of zeros backing untouched heap pages
+int zeroPool[ZERO_POOL_SIZE]; //frames already zeroed while idle
+int zeroPoolCount; //frames in zero pool
+int zeroPoolHits; //zeroed frame requests served from the pool
+int zeroPoolMisses; //zeroed frame requests that had to zero on the spot
+int kstackCache[KSTACK_CACHE_SIZE][KERNEL_STACK_MAXSIZE / PAGESIZE]; //stack frame sets, last freed on top
+int kstackCacheCount;
+int kstackCacheHits; //new kernel stacks served from the cache
+int kstackCacheMisses; //new kernel stacks that had to reserve frames
+pcb_t* reclaimHead; //dead processes waiting to be freed, oldest first
+pcb_t* reclaimTail;
+int reclaimCount;
+int reclaimHighWater; //longest the reclaim list has been
+int reclaimFreed; //dead processes freed off the list
+long reclaimWait; //total ticks freed processes spent on the list
+int reclaimMaxWait; //longest any process waited on the list
+int reclaimRuns; //times memory dropped under the low watermark
+int oomKills; //processes killed to free memory
+int kernelHeapFrames; //frames backing kernel text, data and heap
+int kernelHeapPeak;
+int kernelStackFrames; //frames in kernel stacks of live processes
+int kernelStackPeak;
+int userPageTables; //page tables of live processes
+int userPageTablePeak;
+int userFramePeak; //most frames user land has held at once
+int freeFramesLow = -1; //fewest free frames there have been
 pte_t* kernelPT;
 
+/******************* extern variables *******************/
+extern int currentClockTick;
+extern processes_t* processes;
+
+/******************* local funcs *******************/
+void fillFrame(int frame, void* src);
+void drainZeroPool(int count);
+void drainKernelStackCache();
+void noteUsage();
+int getUserFrames();
+int makeRoom(int count);
+pcb_t* pickOOMVictim(int* reclaimable);
+
 /***************** mem_initFrameVector *****************/
 /*
  * see memory.h for description
@@ -33,21 +88,31 @@ mem_initFrameVector(unsigned int pmemSize)
   //calculate the number of frames
   numFrames = pmemSize / PAGESIZE;
 
-  //each vector can only hold 64 frames, so figure out necessary number of vectors
-  int numVectors = numFrames / (sizeof(u_long) * 8);
+  //each vector can only hold 64 frames, so figure out necessary number of vectors (round up)
+  numVectors = (numFrames + BITS_PER_WORD - 1) / BITS_PER_WORD;
 
-  //malloc space for our vectors
-  frames = calloc(sizeof(u_long), numVectors);
+  //calloc space for our vectors (all frames start unused)
+  frames = calloc(sizeof(frame_word_t), numVectors);
   if (frames == NULL){
     TracePrintf(0, "failed to malloc space for free\n");
     return ERROR;
   }
 
-  //initialize all frames to unused (unnecessary but for peace of mind)
-  for (int vector = 0; vector <= numVectors; vector++){
-    frames[vector] = 0;
+  //bits in the last vector past numFrames don't exist, mark them used so scans skip them
+  for (int frame = numFrames; frame < numVectors * BITS_PER_WORD; frame++){
+    frames[VECTOR_INDEX(frame)] |= BIT_MASK(frame);
   }
 
+  //reference counts for each frame (frames shared after fork have more than 1)
+  frameRefs = calloc(sizeof(unsigned short), numFrames);
+  if (frameRefs == NULL){
+    TracePrintf(0, "failed to malloc space for frame refs\n");
+    return ERROR;
+  }
+
+  freeFrames = numFrames;
+  nextFitVector = 0;
+
   TracePrintf(5, "EXIT mem_initFrameVector\n");
   return 0;
 }
@@ -68,14 +133,17 @@ mem_useFrame(int frameNumber)
   }
 
   //returns error if frame already in use
-  if (mem_isUsedFrame(frameNumber)){
+  frame_word_t* localFrame = &frames[VECTOR_INDEX(frameNumber)];
+  if (*localFrame & BIT_MASK(frameNumber)){
     TracePrintf(3, "That frame is used, unable to allocate again\n");
     return ERROR;
   }
 
-  //get correct vector, set frameNumber in that vector to 1
-  u_long* localFrame = &frames[VECTOR_INDEX(frameNumber)];
-  *localFrame = (*localFrame | (BIT_MASK(frameNumber)));  
+  //set frameNumber in that vector to 1
+  *localFrame |= BIT_MASK(frameNumber);
+  frameRefs[frameNumber] = 1;
+  freeFrames--;
+  noteUsage();
 
   TracePrintf(8, "EXIT mem_useFrame\n");
   return 0;
@@ -97,7 +165,7 @@ mem_isUsedFrame(int frameNumber)
   }
   
   //extract the bit from the correct frame vector and frame index
-  int extractBit = ((frames[VECTOR_INDEX(frameNumber)] & (BIT_MASK(frameNumber))) >> (FRAME_INDEX(frameNumber)));
+  int extractBit = (frames[VECTOR_INDEX(frameNumber)] & BIT_MASK(frameNumber)) != 0;
   
   TracePrintf(8, "EXIT mem_isUsedFrame\n");
 
@@ -120,12 +188,27 @@ mem_freeFrame(int frameNumber)
     return ERROR;
   }
 
+  //freeing an unused frame would throw off the free count
+  frame_word_t* localFrame = &frames[VECTOR_INDEX(frameNumber)];
+  if ((*localFrame & BIT_MASK(frameNumber)) == 0){
+    TracePrintf(3, "Frame %d already free\n", frameNumber);
+    return ERROR;
+  }
+
+  //frame still mapped somewhere else, just drop this reference
+  if (frameRefs[frameNumber] > 1){
+    frameRefs[frameNumber]--;
+    TracePrintf(8, "EXIT mem_freeFrame (%d refs left)\n", frameRefs[frameNumber]);
+    return 0;
+  }
+
   //force free so we don't get unhelpful helper warnings
   helper_force_free(frameNumber);
 
   //set value of frame to 0
-  u_long* localFrame = &frames[VECTOR_INDEX(frameNumber)];
-  *localFrame = (*localFrame ^ (BIT_MASK(frameNumber)));  
+  *localFrame &= ~BIT_MASK(frameNumber);
+  frameRefs[frameNumber] = 0;
+  freeFrames++;
   
   TracePrintf(8, "EXIT mem_freeFrame\n");
   return 0;
@@ -140,15 +223,40 @@ mem_getFreeFrame()
 {
   TracePrintf(8, "ENTER mem_getFreeFrame\n");
 
-  //loop through all frames and return first unused one to user
-  for (int frame = 0; frame < numFrames; frame++){
-    if (mem_isUsedFrame(frame) == 0){
+  //nothing to find, don't bother scanning (zeroed frames are still frames though)
+  if (freeFrames == 0){
+    if (zeroPoolCount > 0){
+      TracePrintf(8, "EXIT mem_getFreeFrame (from zero pool)\n");
+      zeroPoolCount--;
+      noteUsage();
+      return zeroPool[zeroPoolCount];
+    }
+    TracePrintf(8, "EXIT mem_getFreeFrame (no free frames)\n");
+    return ERROR;
+  }
+
+  //walk vectors starting at the next fit cursor, wrapping around once
+  for (int i = 0; i < numVectors; i++){
+    int vector = (nextFitVector + i) % numVectors;
 
-      //mark the frame as used
-      mem_useFrame(frame);
-      TracePrintf(5, "EXIT mem_getFreeFrame %d\n", frame);
-      return frame;
+    //skip vectors with every frame in use
+    if (frames[vector] == FULL_VECTOR){
+      continue;
     }
+
+    //lowest zero bit in the vector is the first free frame in it
+    int bit = __builtin_ctzll(~frames[vector]);
+    int frame = vector * BITS_PER_WORD + bit;
+
+    //mark the frame as used
+    frames[vector] |= BIT_MASK(frame);
+    frameRefs[frame] = 1;
+    freeFrames--;
+    nextFitVector = vector;
+    noteUsage();
+
+    TracePrintf(8, "EXIT mem_getFreeFrame %d\n", frame);
+    return frame;
   }
 
   //no free frames
@@ -156,6 +264,400 @@ mem_getFreeFrame()
   return ERROR;
 }
 
+/***************** mem_getFreeFrameCount *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_getFreeFrameCount()
+{
+  return freeFrames + zeroPoolCount + kstackCacheCount * (KERNEL_STACK_MAXSIZE / PAGESIZE);
+}
+
+/***************** mem_allocFrame *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_allocFrame()
+{
+  int frame = mem_getFreeFrame();
+  if (frame == ERROR && makeRoom(1) == 0){
+    frame = mem_getFreeFrame();
+  }
+
+  return frame;
+}
+
+/***************** mem_getFrameRefs *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_getFrameRefs(int frame)
+{
+  if (frame < 0 || frame >= numFrames){
+    return 0;
+  }
+
+  return frameRefs[frame];
+}
+
+/***************** mem_getZeroedFrame *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_getZeroedFrame()
+{
+  //idle already did the work
+  if (zeroPoolCount > 0){
+    zeroPoolHits++;
+    zeroPoolCount--;
+    noteUsage();
+    return zeroPool[zeroPoolCount];
+  }
+
+  //pool ran dry, zero one ourselves
+  zeroPoolMisses++;
+  int frame = mem_allocFrame();
+  if (frame == ERROR){
+    return ERROR;
+  }
+  fillFrame(frame, NULL);
+
+  return frame;
+}
+
+/***************** mem_fillZeroPool *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_fillZeroPool(int count)
+{
+  TracePrintf(8, "ENTER mem_fillZeroPool (%d frames in pool)\n", zeroPoolCount);
+
+  //take as many free frames as the window and pool have room for
+  int batch[COPY_WINDOW_SLOTS];
+  int batchCount = 0;
+  while (batchCount < count && batchCount < COPY_WINDOW_SLOTS && zeroPoolCount + batchCount < ZERO_POOL_SIZE){
+    //only zero truly free frames, never pull back out of the pool
+    if (freeFrames == 0){
+      break;
+    }
+    batch[batchCount++] = mem_getFreeFrame();
+  }
+
+  if (batchCount == 0){
+    TracePrintf(8, "EXIT mem_fillZeroPool (nothing to zero)\n");
+    return;
+  }
+
+  //zero them all through the window at once
+  void* window = mem_mapWindow(batch, batchCount);
+  memset(window, 0, batchCount * PAGESIZE);
+  mem_unmapWindow(batchCount);
+
+  for (int i = 0; i < batchCount; i++){
+    zeroPool[zeroPoolCount++] = batch[i];
+  }
+
+  TracePrintf(8, "EXIT mem_fillZeroPool (%d frames in pool)\n", zeroPoolCount);
+}
+
+/***************** mem_readFrame *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_readFrame(int frame, void* dst)
+{
+  TracePrintf(8, "ENTER mem_readFrame %d\n", frame);
+
+  void* window = mem_mapWindow(&frame, 1);
+  memcpy(dst, window, PAGESIZE);
+  mem_unmapWindow(1);
+
+  TracePrintf(8, "EXIT mem_readFrame\n");
+}
+
+/***************** mem_mapWindow *****************/
+/*
+ * see memory.h for description
+ */
+void*
+mem_mapWindow(int* frameList, int count)
+{
+  TracePrintf(8, "ENTER mem_mapWindow (%d frames)\n", count);
+
+  if (count < 1 || count > COPY_WINDOW_SLOTS){
+    TracePrintf(0, "mem_mapWindow: can't map %d frames, window has %d slots\n", count, COPY_WINDOW_SLOTS);
+    helper_abort("copy window overrun\n");
+  }
+
+  //slots were flushed when last unmapped, so nothing stale is in the tlb
+  pte_t* kernelPT = mem_getKernelPT();
+  int firstSlot = (KERNEL_STACK_BASE >> PAGESHIFT) - COPY_WINDOW_SLOTS;
+  for (int slot = 0; slot < count; slot++){
+    kernelPT[firstSlot + slot].pfn = frameList[slot];
+    kernelPT[firstSlot + slot].prot = (PROT_READ | PROT_WRITE);
+    kernelPT[firstSlot + slot].valid = 1;
+  }
+
+  TracePrintf(8, "EXIT mem_mapWindow\n");
+  return (void*)(firstSlot << PAGESHIFT);
+}
+
+/***************** mem_unmapWindow *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_unmapWindow(int count)
+{
+  TracePrintf(8, "ENTER mem_unmapWindow (%d frames)\n", count);
+
+  pte_t* kernelPT = mem_getKernelPT();
+  int firstSlot = (KERNEL_STACK_BASE >> PAGESHIFT) - COPY_WINDOW_SLOTS;
+  //flush just the slots, the rest of the kernel's tlb entries are still good
+  //(there's no range flush, so this is one flush per slot, see memory.h)
+  for (int slot = 0; slot < count; slot++){
+    kernelPT[firstSlot + slot].valid = 0;
+    kernelPT[firstSlot + slot].prot = PROT_NONE;
+    WriteRegister(REG_TLB_FLUSH, ((firstSlot + slot) << PAGESHIFT));
+  }
+
+  TracePrintf(8, "EXIT mem_unmapWindow\n");
+}
+
+/***************** mem_writeFrame *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_writeFrame(int frame, void* src)
+{
+  fillFrame(frame, src);
+}
+
+/***************** mem_getZeroPoolStats *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_getZeroPoolStats(int* size, int* hits, int* misses)
+{
+  *size = zeroPoolCount;
+  *hits = zeroPoolHits;
+  *misses = zeroPoolMisses;
+}
+
+/***************** mem_initZeroFrame *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_initZeroFrame()
+{
+  TracePrintf(5, "ENTER mem_initZeroFrame\n");
+
+  //memory.c holds a reference of its own so the frame is never freed
+  zeroFrame = mem_getFreeFrame();
+  if (zeroFrame == ERROR){
+    TracePrintf(0, "No free frame for zero frame\n");
+    return ERROR;
+  }
+  fillFrame(zeroFrame, NULL);
+
+  TracePrintf(5, "EXIT mem_initZeroFrame (frame %d)\n", zeroFrame);
+  return 0;
+}
+
+/***************** mem_mapZeroPages *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_mapZeroPages(pcb_t* pcb, int firstPage, int count)
+{
+  TracePrintf(8, "ENTER mem_mapZeroPages (page %d, %d pages)\n", firstPage, count);
+
+  if (pcb == NULL || firstPage < 0 || firstPage + count > MAX_PT_LEN){
+    TracePrintf(1, "mem_mapZeroPages: pages %d-%d out of bounds\n", firstPage, firstPage + count);
+    return ERROR;
+  }
+
+  //every page reads as zero until it's first written
+  for (int page = firstPage; page < firstPage + count; page++){
+    mem_shareFrame(zeroFrame);
+    pcb->pt[page].pfn = zeroFrame;
+    pcb->pt[page].prot = PROT_READ;
+    pcb->pt[page].valid = 1;
+    pcb->pageFlags[page] = PAGE_ZERO;
+  }
+
+  TracePrintf(8, "EXIT mem_mapZeroPages\n");
+  return 0;
+}
+
+/***************** mem_mergePage *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_mergePage(pcb_t* owner, int ownerPage, pcb_t* pcb, int page)
+{
+  TracePrintf(8, "ENTER mem_mergePage (pid %d page %d)\n", pcb->pid, page);
+
+  int oldFrame = pcb->pt[page].pfn;
+  int freed = (frameRefs[oldFrame] == 1);
+
+  //all zeros, fold into the zero frame like an untouched heap page
+  if (owner == NULL){
+    mem_mapZeroPages(pcb, page, 1);
+    mem_freeFrame(oldFrame);
+
+    TracePrintf(8, "EXIT mem_mergePage (zero frame)\n");
+    return freed;
+  }
+
+  //owner keeps its frame but can't write it in place anymore
+  if (owner->pt[ownerPage].prot & PROT_WRITE){
+    owner->pt[ownerPage].prot &= ~PROT_WRITE;
+    owner->pageFlags[ownerPage] |= PAGE_COW;
+  }
+
+  //point page at owner's frame, first write gets it a copy again
+  int frame = owner->pt[ownerPage].pfn;
+  mem_shareFrame(frame);
+  pcb->pt[page].pfn = frame;
+  pcb->pt[page].prot &= ~PROT_WRITE;
+  pcb->pageFlags[page] |= PAGE_COW;
+  mem_freeFrame(oldFrame);
+
+  TracePrintf(8, "EXIT mem_mergePage\n");
+  return freed;
+}
+
+/***************** mem_shareFrame *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_shareFrame(int frameNumber)
+{
+  TracePrintf(8, "ENTER mem_shareFrame %d\n", frameNumber);
+
+  //can only share a frame that is already in use
+  if (mem_isUsedFrame(frameNumber) != 1){
+    TracePrintf(3, "Can't share unused frame %d\n", frameNumber);
+    return ERROR;
+  }
+
+  frameRefs[frameNumber]++;
+
+  TracePrintf(8, "EXIT mem_shareFrame (%d refs)\n", frameRefs[frameNumber]);
+  return 0;
+}
+
+/***************** mem_reserveFrames *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_reserveFrames(int* frameList, int count)
+{
+  TracePrintf(8, "ENTER mem_reserveFrames (%d frames)\n", count);
+
+  if (frameList == NULL || count < 0){
+    TracePrintf(3, "Invalid args to mem_reserveFrames\n");
+    return ERROR;
+  }
+
+  //get free frames (pool included) up to count, or give up without taking any
+  if (makeRoom(count) == ERROR){
+    TracePrintf(3, "mem_reserveFrames: want %d frames, only %d free\n", count, freeFrames + zeroPoolCount);
+    return ERROR;
+  }
+
+  //pool frames go back to being plain free frames if we need them
+  if (count > freeFrames){
+    drainZeroPool(count - freeFrames);
+  }
+
+  //all or nothing, so refuse up front if the count can't cover it
+  if (count > freeFrames){
+    TracePrintf(3, "mem_reserveFrames: want %d frames, only %d free\n", count, freeFrames);
+    return ERROR;
+  }
+
+  //one pass over the vectors from the next fit cursor, pulling every free bit we need
+  int found = 0;
+  for (int i = 0; i < numVectors && found < count; i++){
+    int vector = (nextFitVector + i) % numVectors;
+    frame_word_t avail = ~frames[vector];
+
+    while (avail != 0 && found < count){
+      int bit = __builtin_ctzll(avail);
+      avail &= avail - 1; //clear lowest set bit
+
+      frames[vector] |= (((frame_word_t)1) << bit);
+      frameList[found] = vector * BITS_PER_WORD + bit;
+      frameRefs[frameList[found]] = 1;
+      found++;
+    }
+    nextFitVector = vector;
+  }
+
+  freeFrames -= found;
+  noteUsage();
+
+  TracePrintf(8, "EXIT mem_reserveFrames\n");
+  return 0;
+}
+
+/***************** mem_releaseFrames *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_releaseFrames(int* frameList, int count)
+{
+  TracePrintf(8, "ENTER mem_releaseFrames (%d frames)\n", count);
+
+  for (int i = 0; i < count; i++){
+    mem_freeFrame(frameList[i]);
+  }
+
+  TracePrintf(8, "EXIT mem_releaseFrames\n");
+}
+
+/***************** mem_mapUserPages *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_mapUserPages(pte_t* pt, int firstPage, int count, u_long prot, int* frameList)
+{
+  TracePrintf(8, "ENTER mem_mapUserPages (page %d, %d pages)\n", firstPage, count);
+
+  if (pt == NULL || frameList == NULL || firstPage < 0 || firstPage + count > MAX_PT_LEN){
+    TracePrintf(1, "mem_mapUserPages: pages %d-%d out of bounds\n", firstPage, firstPage + count);
+    return ERROR;
+  }
+
+  //mark each page with its reserved frame
+  for (int i = 0; i < count; i++){
+    pt[firstPage + i].pfn = frameList[i];
+    pt[firstPage + i].valid = 1;
+    pt[firstPage + i].prot = prot;
+  }
+
+  TracePrintf(8, "EXIT mem_mapUserPages\n");
+  return 0;
+}
+
 
 /***************** mem_initKernelPT *****************/
 /*
@@ -184,6 +686,7 @@ mem_initKernelPT(int brkDiff)
     if (_first_kernel_data_page > page && page >= _first_kernel_text_page){
 
       //use the frame and modify the pte so pfn = vpn
+      kernelHeapFrames++;
       mem_useFrame(page); 
       kernelPT[page].valid = 1;
       kernelPT[page].pfn = page;
@@ -195,6 +698,7 @@ mem_initKernelPT(int brkDiff)
     } else if (brk > page && page >= _first_kernel_data_page){
 
       //use the frame and modify the pte so pfn = vpn
+      kernelHeapFrames++;
       mem_useFrame(page);
       kernelPT[page].valid = 1;
       kernelPT[page].pfn = page;
@@ -205,7 +709,8 @@ mem_initKernelPT(int brkDiff)
     //if page corresponds to spot in stack
     } else if (page >= firstStackPage){
 
-      //use the frame and modify the pte so pfn = vpn
+      //use the frame and modify the pte so pfn = vpn (init inherits this stack)
+      kernelStackFrames++;
       mem_useFrame(page);
       kernelPT[page].valid = 1;
       kernelPT[page].pfn = page;
@@ -261,13 +766,26 @@ mem_newKernelStack(pcb_t* pcb)
     return ERROR;
   }
 
-  //allocate the pcb the required amount of stack frames
-  for (int frame = 0; frame < totalStackFrames; frame++){
-    int f = mem_getFreeFrame();
-    if (f == ERROR){
-      return ERROR;
-    }
-    pcb->kstack[frame] = f;
+  //reuse the stack of the last process to go (its frames are likely still cached)
+  if (kstackCacheCount > 0){
+    kstackCacheCount--;
+    memcpy(pcb->kstack, kstackCache[kstackCacheCount], sizeof(pcb->kstack));
+    kstackCacheHits++;
+    kernelStackFrames += totalStackFrames;
+    noteUsage();
+
+    TracePrintf(5, "EXIT mem_newKernelStack (from cache)\n");
+    return 0;
+  }
+
+  //allocate the pcb the required amount of stack frames (all or none)
+  //(counted first so the frames never look like user frames)
+  kstackCacheMisses++;
+  kernelStackFrames += totalStackFrames;
+  if (mem_reserveFrames(pcb->kstack, totalStackFrames) == ERROR){
+    TracePrintf(1, "No free frames for new kernel stack\n");
+    kernelStackFrames -= totalStackFrames;
+    return ERROR;
   }
 
   TracePrintf(5, "EXIT mem_newKernelStack\n");
@@ -331,6 +849,8 @@ mem_initUserPT()
   for(int page = 0; page < MAX_PT_LEN; page++){
     userPT[page].valid = 0;
   }
+  userPageTables++;
+  noteUsage();
 
   TracePrintf(5, "EXIT mem_initUserPT\n");
   return userPT;
@@ -371,71 +891,163 @@ mem_copyPT(pcb_t* proc1, pcb_t* proc2)
 {
   TracePrintf(5, "ENTER mem_copyPT\n");
 
-  //get the kernel pt (used as a temp holder to modify frames)
-  pte_t* kernelPT = mem_getKernelPT();
-
-  //use the first page under kernel stack as temp
-  int stackSize = (KERNEL_STACK_MAXSIZE / PAGESIZE);
-  int firstStackPage = (KERNEL_STACK_BASE >> PAGESHIFT);
-  kernelPT[firstStackPage - 1].prot = (PROT_READ | PROT_WRITE);
-  kernelPT[firstStackPage - 1].valid = 1;
+  //sampled pages get their real protection back before it's copied
+  ws_restore(proc1);
 
   //get pts to copy from and to
   pte_t* pt1 = proc1->pt;
   pte_t* pt2 = proc2->pt;
 
-  //for each page
-  for (int page = 0; page < MAX_PT_LEN; page++){
-    if (pt1[page].valid == 1){
+  //child has the same regions (its pages come in below, til then they're invalid and unflagged)
+  memcpy(proc2->vmas, proc1->vmas, sizeof(proc1->vmas));
+  proc2->numVmas = proc1->numVmas;
+
+  //for each page in use
+  for (int v = 0; v < proc1->numVmas; v++){
+    vma_t* vma = &(proc1->vmas[v]);
+    for (int page = vma->firstPage; page < vma->firstPage + vma->numPages; page++){
+
+      //carry over state of unmapped pages too (file backed pages aren't valid yet)
+      proc2->pageFlags[page] = proc1->pageFlags[page];
+      proc2->pageAge[page] = proc1->pageAge[page];
 
-      //match the page from pt1 to pt2
-      if (mem_setUserPTE(pt2, page, pt1[page].prot) == ERROR){
-        TracePrintf(0, "Failed to copy page\n");
-        return ERROR;
+      //paged out pages share the swap slot (or store entry), each process reads its own copy back in
+      if (pt1[page].valid == 0 && (proc1->pageFlags[page] & PAGE_SWAP)){
+        pt2[page] = pt1[page];
+        swap_sharePage(proc1, page);
+      }
+
+      //shared segment pages stay shared and writable in both
+      if (pt1[page].valid == 1 && (proc1->pageFlags[page] & PAGE_SHARED)){
+        if (mem_shareFrame(pt1[page].pfn) == ERROR){
+          TracePrintf(0, "Failed to share frame for page %d\n", page);
+          return ERROR;
+        }
+        pt2[page] = pt1[page];
+      }
+
+      else if (pt1[page].valid == 1){
+
+        //writable pages become read only copy on write in both processes
+        if (pt1[page].prot & PROT_WRITE){
+          pt1[page].prot &= ~PROT_WRITE;
+          proc1->pageFlags[page] |= PAGE_COW;
+        }
+
+        //point pt2 at the same frame as pt1
+        if (mem_shareFrame(pt1[page].pfn) == ERROR){
+          TracePrintf(0, "Failed to share frame for page %d\n", page);
+          return ERROR;
+        }
+        pt2[page].pfn = pt1[page].pfn;
+        pt2[page].prot = pt1[page].prot;
+        pt2[page].valid = 1;
+        proc2->pageFlags[page] = proc1->pageFlags[page];
       }
-      
-      //copy the contents to the pfn for pt2 (using the kernel page as the temp holder for this)
-      kernelPT[firstStackPage - 1].pfn = pt2[page].pfn;
-      WriteRegister(REG_TLB_FLUSH, ((firstStackPage - 1) << PAGESHIFT));
-      memcpy((void*)((firstStackPage - 1) << PAGESHIFT), (void*)(((page) << PAGESHIFT) + VMEM_1_BASE), PAGESIZE);
     }
   }
 
-  //unmark use of kernel page
-  kernelPT[firstStackPage - 1].valid = 0;
-  kernelPT[firstStackPage - 1].prot = PROT_NONE;
-  WriteRegister(REG_TLB_FLUSH, ((firstStackPage - 1) << PAGESHIFT));
+  //proc1 just lost write on its pages, drop any stale tlb entries
+  WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
 
   TracePrintf(5, "EXIT mem_copyPT\n");
   return 0;
 }
 
-/***************** mem_setUserPTE *****************/
+/***************** mem_handleWriteFault *****************/
 /*
  * see memory.h for description
  */
-int 
-mem_setUserPTE(pte_t* pt, int page, u_long prot)
+int
+mem_handleWriteFault(pcb_t* pcb, int page)
 {
-  TracePrintf(5, "ENTER mem_setUserPTE\n");
+  TracePrintf(5, "ENTER mem_handleWriteFault (page %d)\n", page);
 
-  int frame = mem_getFreeFrame();
-  if (frame == ERROR){
-    TracePrintf(0, "mem_setUserPTE: no free frame\n");
-    return ERROR;
+  //writes outside a writable region are never allowed
+  vma_t* vma = mem_findVMA(pcb, page);
+  if (vma == NULL || (vma->prot & PROT_WRITE) == 0){
+    TracePrintf(3, "Page %d not in a writable region\n", page);
+    return 0;
+  }
+
+  pte_t* pt = pcb->pt;
+  if (pt[page].valid == 0 || (pcb->pageFlags[page] & (PAGE_COW | PAGE_ZERO)) == 0){
+    TracePrintf(5, "EXIT mem_handleWriteFault (page %d not copy on write)\n", page);
+    return 0;
+  }
+
+  int oldFrame = pt[page].pfn;
+
+  //first write to an untouched heap page, swap the zero frame for a real one
+  if (pcb->pageFlags[page] & PAGE_ZERO){
+    int newFrame = mem_getZeroedFrame();
+    if (newFrame == ERROR){
+      TracePrintf(1, "No free frame for zero page %d\n", page);
+      return ERROR;
+    }
+
+    pt[page].pfn = newFrame;
+    pt[page].prot = (PROT_READ | PROT_WRITE);
+    pcb->pageFlags[page] &= ~PAGE_ZERO;
+    pcb->pageFlags[page] |= PAGE_REF;
+    mem_freeFrame(oldFrame);
+    WriteRegister(REG_TLB_FLUSH, (page << PAGESHIFT) + VMEM_1_BASE);
+
+    TracePrintf(5, "EXIT mem_handleWriteFault (zero page filled)\n");
+    return 1;
+  }
+
+  //someone still shares the frame, give this process its own copy
+  if (frameRefs[oldFrame] > 1){
+    int newFrame = mem_allocFrame();
+    if (newFrame == ERROR){
+      TracePrintf(1, "No free frame to copy page %d\n", page);
+      return ERROR;
+    }
+
+    fillFrame(newFrame, (void*)((page << PAGESHIFT) + VMEM_1_BASE));
+    pt[page].pfn = newFrame;
+    pcb->pageFlags[page] |= PAGE_REF;
+    mem_freeFrame(oldFrame);
   }
 
+  //last (or only) owner of the frame gets write back
+  pt[page].prot |= PROT_WRITE;
+  pcb->pageFlags[page] &= ~PAGE_COW;
+  WriteRegister(REG_TLB_FLUSH, (page << PAGESHIFT) + VMEM_1_BASE);
+
+  TracePrintf(5, "EXIT mem_handleWriteFault\n");
+  return 1;
+}
+
+/***************** mem_setUserPTE *****************/
+/*
+ * see memory.h for description
+ */
+int 
+mem_setUserPTE(pte_t* pt, int page, u_long prot)
+{
+  TracePrintf(5, "ENTER mem_setUserPTE\n");
+
   if (page < 0 || page >= MAX_PT_LEN) {
     TracePrintf(1, "mem_setUserPTE: Address (page %d) out of bounds.\n", page);
     return ERROR;
   }
 
+  //user never gets to see what was left in the frame by its last owner
+  int frame = mem_getZeroedFrame();
+  if (frame == ERROR){
+    TracePrintf(0, "mem_setUserPTE: no free frame\n");
+    return ERROR;
+  }
+
   //mark page with proper fields 
   pt[page].pfn = frame;
   pt[page].valid = 1;
   pt[page].prot = prot;
 
   TracePrintf(5, "EXIT mem_setUserPTE: Set page %d to frame %d with prot 0x%x\n", page, frame, prot);
+  return 0;
 }
 
 /***************** mem_stackBrk *****************/
@@ -443,20 +1055,142 @@ mem_setUserPTE(pte_t* pt, int page, u_long prot)
  * see memory.h for description
  */
 int
-mem_getStackBrk(pte_t* pt)
+mem_getStackBrk(pcb_t* pcb)
 {
   TracePrintf(5, "ENTER mem_getStackBrk\n");
   
-  //work down from top of pt until get an invalid page (that page is stack brk)
-  int page = MAX_PT_LEN - 1;
-  while (pt[page].valid == 1){
-    page--;
-  }
+  //page right under the stack region
+  vma_t* stack = mem_getVMA(pcb, VMA_STACK);
+  int page = (stack != NULL) ? stack->firstPage - 1 : MAX_PT_LEN - 1;
 
   TracePrintf(5, "EXIT mem_getStackBrk (page %d)\n", page);
   return page;
 }
 
+/***************** mem_growStack *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_growStack(pcb_t* pcb, int page)
+{
+  TracePrintf(5, "ENTER mem_growStack (down to page %d)\n", page);
+
+  vma_t* stack = mem_getVMA(pcb, VMA_STACK);
+  if (stack == NULL){
+    TracePrintf(1, "mem_growStack: process %d has no stack\n", pcb->pid);
+    return ERROR;
+  }
+
+  //region grows a page at a time so it always covers what's mapped
+  while (stack->firstPage > page){
+    if (mem_setUserPTE(pcb->pt, stack->firstPage - 1, stack->prot) == ERROR){
+      TracePrintf(1, "mem_growStack: no frame for page %d\n", stack->firstPage - 1);
+      return ERROR;
+    }
+    pcb->pageFlags[stack->firstPage - 1] = PAGE_REF;
+    stack->firstPage--;
+    stack->numPages++;
+  }
+
+  TracePrintf(5, "EXIT mem_growStack\n");
+  return 0;
+}
+
+/***************** mem_addVMA *****************/
+/*
+ * see memory.h for description
+ */
+vma_t*
+mem_addVMA(pcb_t* pcb, int type, int firstPage, int numPages, u_long prot)
+{
+  if (pcb->numVmas >= MAX_VMAS){
+    TracePrintf(1, "mem_addVMA: process %d has no room for another region\n", pcb->pid);
+    return NULL;
+  }
+
+  vma_t* vma = &(pcb->vmas[pcb->numVmas++]);
+  vma->type = type;
+  vma->firstPage = firstPage;
+  vma->numPages = numPages;
+  vma->prot = prot;
+
+  return vma;
+}
+
+/***************** mem_removeVMA *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_removeVMA(pcb_t* pcb, vma_t* vma)
+{
+  //order doesn't matter, last region fills the hole
+  pcb->numVmas--;
+  *vma = pcb->vmas[pcb->numVmas];
+}
+
+/***************** mem_findVMA *****************/
+/*
+ * see memory.h for description
+ */
+vma_t*
+mem_findVMA(pcb_t* pcb, int page)
+{
+  for (int v = 0; v < pcb->numVmas; v++){
+    vma_t* vma = &(pcb->vmas[v]);
+    if (page >= vma->firstPage && page < vma->firstPage + vma->numPages){
+      return vma;
+    }
+  }
+
+  return NULL;
+}
+
+/***************** mem_getVMA *****************/
+/*
+ * see memory.h for description
+ */
+vma_t*
+mem_getVMA(pcb_t* pcb, int type)
+{
+  for (int v = 0; v < pcb->numVmas; v++){
+    if (pcb->vmas[v].type == type){
+      return &(pcb->vmas[v]);
+    }
+  }
+
+  return NULL;
+}
+
+/***************** mem_freeRegions *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_freeRegions(pcb_t* pcb)
+{
+  TracePrintf(5, "ENTER mem_freeRegions\n");
+
+  pte_t* pt = pcb->pt;
+  for (int v = 0; v < pcb->numVmas; v++){
+    vma_t* vma = &(pcb->vmas[v]);
+    for (int page = vma->firstPage; page < vma->firstPage + vma->numPages; page++){
+      swap_dropPage(pcb, page);
+      if (pt[page].valid == 1){
+        mem_freeFrame(pt[page].pfn);
+        pt[page].valid = 0;
+        pt[page].prot = PROT_NONE;
+      }
+      pcb->pageFlags[page] = 0;
+      pcb->pageAge[page] = 0;
+    }
+  }
+  pcb->numVmas = 0;
+
+  TracePrintf(5, "EXIT mem_freeRegions\n");
+}
+
 /***************** mem_getKernelPT *****************/
 /*
  * see memory.h for description
@@ -525,6 +1259,30 @@ mem_freePT(pte_t* pt)
   TracePrintf(5, "EXIT mem_freePT\n");
 }
 
+/***************** mem_freeAddressSpace *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_freeAddressSpace(pcb_t* pcb)
+{
+  TracePrintf(5, "ENTER mem_freeAddressSpace\n");
+
+  //let go of shared segments
+  shm_detachAll(pcb);
+
+  //free every frame (and whatever was paged out)
+  if (pcb->pt != NULL){
+    mem_freeRegions(pcb);
+  }
+
+  //let go of program file
+  ReleaseImage(pcb->image);
+  pcb->image = NULL;
+
+  TracePrintf(5, "EXIT mem_freeAddressSpace\n");
+}
+
 /***************** mem_freePCB *****************/
 /*
  * see memory.h for description
@@ -537,30 +1295,288 @@ mem_freePCB(pcb_t* pcb)
   int pid;
   if (pcb != NULL) {
 
-    //retire pid
+    //retire pid (and drop it from the process table)
+    coord_unregisterProcess(pcb);
     pid = pcb->pid;
     if (pid != 0){
       helper_retire_pid(pid);
     }
 
-    //free pt
+    //free frames, segments and program file (if exit didn't already)
+    mem_freeAddressSpace(pcb);
     if (pcb->pt != NULL){
-      mem_freePT(pcb->pt);
+      free(pcb->pt);
+      pcb->pt = NULL;
+      userPageTables--;
+    }
+
+    //exit records (ours if never handed to a parent, and any of children never waited on)
+    if (pcb->exitRecord != NULL){
+      slab_free(&exitCache, pcb->exitRecord);
+    }
+    while (pcb->exited != NULL){
+      exitRecord_t* record = pcb->exited;
+      pcb->exited = record->next;
+      slab_free(&exitCache, record);
     }
 
-    //free stack frames
+    //keep stack frames for the next fork if there's room, otherwise free them
     int kPages = KERNEL_STACK_MAXSIZE/PAGESIZE;
-    for (int i = 0; i < kPages; i++){
-      mem_freeFrame(pcb->kstack[i]);
+    kernelStackFrames -= kPages;
+    if (kstackCacheCount < KSTACK_CACHE_SIZE){
+      memcpy(kstackCache[kstackCacheCount], pcb->kstack, sizeof(pcb->kstack));
+      kstackCacheCount++;
+    } else {
+      mem_releaseFrames(pcb->kstack, kPages);
     }
 
-    free(pcb);
+    //nothing points at these anymore, don't let the next fork see them
+    pcb->pid = 0;
+    pcb->exitRecord = NULL;
+    slab_free(&pcbCache, pcb);
     pcb = NULL;
   }
 
   TracePrintf(5, "EXIT mem_freePCB \n");
 }
 
+/***************** mem_reclaimFrames *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_reclaimFrames(int target, int canSwap)
+{
+  TracePrintf(5, "ENTER mem_reclaimFrames (want %d, have %d)\n", target, freeFrames + zeroPoolCount);
+
+  //cheapest first: dead processes, cached kernel stacks, then text of programs no one runs
+  if (freeFrames + zeroPoolCount < target){
+    mem_drainReclaim(reclaimCount);
+  }
+  if (freeFrames + zeroPoolCount < target){
+    drainKernelStackCache();
+  }
+  if (freeFrames + zeroPoolCount < target){
+    PurgeImages();
+  }
+
+  //then page out victims til free frames (pool included) reach target, compressed in memory if
+  //they shrink (which never blocks) and to disk if not
+  while (freeFrames + zeroPoolCount < target){
+    int frame = swap_compress();
+    if (frame == ERROR && canSwap){
+      frame = swap_evict();
+    }
+    if (frame == ERROR){
+      break;
+    }
+    mem_freeFrame(frame);
+  }
+
+  TracePrintf(5, "EXIT mem_reclaimFrames (have %d)\n", freeFrames + zeroPoolCount);
+  return freeFrames + zeroPoolCount;
+}
+
+/***************** mem_checkWatermarks *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_checkWatermarks(int canSwap)
+{
+  if (freeFrames + zeroPoolCount >= FRAMES_LOW_WATER){
+    return;
+  }
+
+  reclaimRuns++;
+  int avail = mem_reclaimFrames(FRAMES_HIGH_WATER, canSwap);
+  TracePrintf(3, "mem_checkWatermarks: under low watermark, %d frames free after reclaim\n", avail);
+}
+
+/***************** mem_getResidentPages *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_getResidentPages(pcb_t* pcb)
+{
+  int resident = 0;
+  if (pcb->pt == NULL){
+    return 0;
+  }
+
+  for (int v = 0; v < pcb->numVmas; v++){
+    vma_t* vma = &(pcb->vmas[v]);
+    for (int page = vma->firstPage; page < vma->firstPage + vma->numPages; page++){
+      //untouched heap pages all share the zero frame, they cost nothing
+      if (pcb->pt[page].valid && pcb->pt[page].pfn != zeroFrame){
+        resident++;
+      }
+    }
+  }
+
+  return resident;
+}
+
+/***************** mem_deferFreePCB *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_deferFreePCB(pcb_t* pcb)
+{
+  TracePrintf(5, "ENTER mem_deferFreePCB (pid %d)\n", pcb->pid);
+
+  pcb->next = NULL;
+  pcb->deathTick = currentClockTick;
+  if (reclaimTail == NULL){
+    reclaimHead = pcb;
+  } else {
+    reclaimTail->next = pcb;
+  }
+  reclaimTail = pcb;
+
+  reclaimCount++;
+  if (reclaimCount > reclaimHighWater){
+    reclaimHighWater = reclaimCount;
+  }
+
+  TracePrintf(5, "EXIT mem_deferFreePCB (%d waiting)\n", reclaimCount);
+}
+
+/***************** mem_drainReclaim *****************/
+/*
+ * see memory.h for description
+ */
+int
+mem_drainReclaim(int count)
+{
+  int freed = 0;
+  while (freed < count && reclaimHead != NULL){
+    pcb_t* pcb = reclaimHead;
+    reclaimHead = pcb->next;
+    if (reclaimHead == NULL){
+      reclaimTail = NULL;
+    }
+    reclaimCount--;
+
+    int waited = currentClockTick - pcb->deathTick;
+    reclaimWait += waited;
+    if (waited > reclaimMaxWait){
+      reclaimMaxWait = waited;
+    }
+
+    mem_freePCB(pcb);
+    reclaimFreed++;
+    freed++;
+  }
+
+  if (freed > 0){
+    TracePrintf(3, "mem_drainReclaim: freed %d dead processes, %d still waiting\n", freed, reclaimCount);
+  }
+  return freed;
+}
+
+/***************** mem_getReclaimStats *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_getReclaimStats(int* pending, int* highWater, int* freed, int* maxWait)
+{
+  *pending = reclaimCount;
+  *highWater = reclaimHighWater;
+  *freed = reclaimFreed;
+  *maxWait = reclaimMaxWait;
+}
+
+/***************** mem_addKernelHeapFrames *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_addKernelHeapFrames(int count)
+{
+  kernelHeapFrames += count;
+  noteUsage();
+}
+
+/***************** mem_getStats *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_getStats(int* stats)
+{
+  TracePrintf(5, "ENTER mem_getStats\n");
+
+  stats[MEMSTAT_TOTAL] = numFrames;
+  stats[MEMSTAT_FREE] = freeFrames + zeroPoolCount;
+  stats[MEMSTAT_FREE_LOW] = freeFramesLow;
+  stats[MEMSTAT_KHEAP] = kernelHeapFrames;
+  stats[MEMSTAT_KHEAP_PEAK] = kernelHeapPeak;
+  stats[MEMSTAT_KSTACK] = kernelStackFrames;
+  stats[MEMSTAT_KSTACK_PEAK] = kernelStackPeak;
+  stats[MEMSTAT_PTABLE] = userPageTables;
+  stats[MEMSTAT_PTABLE_PEAK] = userPageTablePeak;
+  stats[MEMSTAT_USER] = getUserFrames();
+  stats[MEMSTAT_USER_PEAK] = userFramePeak;
+  zcache_getStats(&stats[MEMSTAT_ZCACHE_FRAMES], &stats[MEMSTAT_ZCACHE_PAGES], &stats[MEMSTAT_ZCACHE_BYTES]);
+  zcache_getTotals(&stats[MEMSTAT_ZCACHE_STORES], &stats[MEMSTAT_ZCACHE_LOADS]);
+  stats[MEMSTAT_CACHED] = kstackCacheCount * (KERNEL_STACK_MAXSIZE / PAGESIZE) + (zeroFrame != ERROR)
+      + stats[MEMSTAT_ZCACHE_FRAMES];
+
+  //walk the bitmap for runs of free frames (pool frames are marked used in it)
+  int runs = 0;
+  int largest = 0;
+  int run = 0;
+  for (int frame = 0; frame < numFrames; frame++){
+    if (frames[VECTOR_INDEX(frame)] & BIT_MASK(frame)){
+      run = 0;
+      continue;
+    }
+    if (run == 0){
+      runs++;
+    }
+    run++;
+    if (run > largest){
+      largest = run;
+    }
+  }
+  stats[MEMSTAT_FREE_RUNS] = runs;
+  stats[MEMSTAT_LARGEST_RUN] = largest;
+
+  dedup_getStats(&stats[MEMSTAT_DEDUP_SCANNED], &stats[MEMSTAT_DEDUP_MERGED], &stats[MEMSTAT_DEDUP_SAVED]);
+  ws_getStats(&stats[MEMSTAT_WS_ROUNDS], &stats[MEMSTAT_WS_FAULTS]);
+  //(nobody is running once processes are torn down at halt)
+  pcb_t* curr = coord_getRunningProcess();
+  stats[MEMSTAT_WS_SELF] = (curr != NULL) ? curr->workingSet : 0;
+
+  TracePrintf(5, "EXIT mem_getStats\n");
+}
+
+/***************** mem_traceStats *****************/
+/*
+ * see memory.h for description
+ */
+void
+mem_traceStats(int level, char* when)
+{
+  int stats[MEMSTAT_COUNT];
+  mem_getStats(stats);
+
+  TracePrintf(level, "frames %s: %d total, %d free (low %d) in %d runs (largest %d)\n", when,
+      stats[MEMSTAT_TOTAL], stats[MEMSTAT_FREE], stats[MEMSTAT_FREE_LOW], stats[MEMSTAT_FREE_RUNS], stats[MEMSTAT_LARGEST_RUN]);
+  TracePrintf(level, "frames %s: kernel heap %d (peak %d), kernel stacks %d (peak %d), user %d (peak %d), cached %d\n", when,
+      stats[MEMSTAT_KHEAP], stats[MEMSTAT_KHEAP_PEAK], stats[MEMSTAT_KSTACK], stats[MEMSTAT_KSTACK_PEAK],
+      stats[MEMSTAT_USER], stats[MEMSTAT_USER_PEAK], stats[MEMSTAT_CACHED]);
+  TracePrintf(level, "frames %s: %d user page tables (peak %d)\n", when, stats[MEMSTAT_PTABLE], stats[MEMSTAT_PTABLE_PEAK]);
+  TracePrintf(level, "frames %s: compressed store %d frames holding %d pages in %d bytes\n", when,
+      stats[MEMSTAT_ZCACHE_FRAMES], stats[MEMSTAT_ZCACHE_PAGES], stats[MEMSTAT_ZCACHE_BYTES]);
+  TracePrintf(level, "frames %s: dedup scanned %d pages, merged %d, saved %d frames\n", when,
+      stats[MEMSTAT_DEDUP_SCANNED], stats[MEMSTAT_DEDUP_MERGED], stats[MEMSTAT_DEDUP_SAVED]);
+}
+
 /***************** mem_exit *****************/
 /*
  * see memory.h for description
@@ -569,6 +1585,7 @@ void
 mem_exit()
 {
   TracePrintf(5, "ENTER mem_exit\n");
+  mem_traceStats(1, "at halt");
 
   //free all locks and cvars
   sync_free();
@@ -576,21 +1593,270 @@ mem_exit()
   //free pipes
   sys_freePipes();
 
-  //free processes
+  //free processes (and the dead ones still waiting on the reclaim list)
   coord_freeProcesses();
+  TracePrintf(1, "reclaim: %d dead processes freed, %d left at exit, list peaked at %d, avg wait %d ticks (max %d)\n",
+      reclaimFreed, reclaimCount, reclaimHighWater, reclaimFreed ? (int)(reclaimWait / reclaimFreed) : 0, reclaimMaxWait);
+  mem_drainReclaim(reclaimCount);
+  TracePrintf(1, "memory pressure: %d reclaims under low watermark, %d processes killed out of memory\n", reclaimRuns, oomKills);
+
+  //close programs left in the image cache and free their text frames
+  PurgeImages();
+
+  swap_exit();
+  zcache_exit();
+  shm_exit();
+  dedup_exit();
+  ws_exit();
+  timer_exit();
+
+  //no process is left, so anything still counted against one leaked
+  mem_traceStats(1, "after freeing processes");
+  if (getUserFrames() != 0 || kernelStackFrames != 0 || userPageTables != 0){
+    TracePrintf(0, "LEAK: %d user frames, %d kernel stack frames, %d page tables never freed\n",
+        getUserFrames(), kernelStackFrames, userPageTables);
+  }
 
-  //free frame vector
-  free(frames);
+  //every kernel object is back in its cache by now
+  slab_exit();
 
   //free interrupt table
   fptr* interruptTable = (fptr*)ReadRegister(REG_VECTOR_BASE);
   free(interruptTable);
 
-  //free kernel pt
+  //free kernel pt (before the frame vector, freeing its frames touches the vector)
   pte_t* pt = mem_getKernelPT();
   if (pt != NULL){
     mem_freePT(pt);
   }
 
+  TracePrintf(1, "zero pool: %d frames, %d hits, %d misses\n", zeroPoolCount, zeroPoolHits, zeroPoolMisses);
+  drainZeroPool(zeroPoolCount);
+
+  TracePrintf(1, "kernel stack cache: %d stacks, %d hits, %d misses\n", kstackCacheCount, kstackCacheHits, kstackCacheMisses);
+  drainKernelStackCache();
+
+  //drop memory.c's own hold on the zero frame
+  if (zeroFrame != ERROR){
+    mem_freeFrame(zeroFrame);
+  }
+
+  //free frame vector
+  free(frames);
+  free(frameRefs);
+
   TracePrintf(5, "EXIT mem_exit\n");
 }
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** fillFrame ********************/
+/*
+ * copy a page of memory into a physical frame (or zero it)
+ *  using the page under the kernel stack as a temporary mapping
+ *
+ * input:
+ *  frame - frame to fill
+ *  src - virtual address of page to copy from, NULL to zero
+ *
+ * output:
+ *  none
+ *
+ */
+void
+fillFrame(int frame, void* src)
+{
+  TracePrintf(8, "ENTER fillFrame %d\n", frame);
+
+  void* window = mem_mapWindow(&frame, 1);
+  if (src != NULL){
+    memcpy(window, src, PAGESIZE);
+  } else {
+    memset(window, 0, PAGESIZE);
+  }
+  mem_unmapWindow(1);
+
+  TracePrintf(8, "EXIT fillFrame\n");
+}
+
+/******************** drainZeroPool ********************/
+/*
+ * hand frames in the zero pool back to the free frames
+ *
+ * input:
+ *  count - most frames to give back
+ *
+ * output:
+ *  none
+ *
+ */
+void
+drainZeroPool(int count)
+{
+  while (count > 0 && zeroPoolCount > 0){
+    mem_freeFrame(zeroPool[--zeroPoolCount]);
+    count--;
+  }
+}
+
+/******************** drainKernelStackCache ********************/
+/*
+ * free every kernel stack frame set held in the cache
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+void
+drainKernelStackCache()
+{
+  while (kstackCacheCount > 0){
+    kstackCacheCount--;
+    mem_releaseFrames(kstackCache[kstackCacheCount], KERNEL_STACK_MAXSIZE / PAGESIZE);
+  }
+}
+
+/******************** getUserFrames ********************/
+/*
+ * count frames held by user land (whatever isn't free or
+ *  counted against the kernel)
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  return number of user frames
+ *
+ */
+int
+getUserFrames()
+{
+  int kstackCacheFrames = kstackCacheCount * (KERNEL_STACK_MAXSIZE / PAGESIZE);
+  int storeFrames, storePages, storeBytes;
+  zcache_getStats(&storeFrames, &storePages, &storeBytes);
+  return numFrames - freeFrames - zeroPoolCount - kernelHeapFrames - kernelStackFrames
+      - kstackCacheFrames - (zeroFrame != ERROR) - storeFrames;
+}
+
+/******************** noteUsage ********************/
+/*
+ * bump the high-water marks (and free low-water mark) after
+ *  frames change hands
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+void
+noteUsage()
+{
+  int free = freeFrames + zeroPoolCount;
+  if (freeFramesLow == -1 || free < freeFramesLow){
+    freeFramesLow = free;
+  }
+  if (kernelHeapFrames > kernelHeapPeak){
+    kernelHeapPeak = kernelHeapFrames;
+  }
+  if (kernelStackFrames > kernelStackPeak){
+    kernelStackPeak = kernelStackFrames;
+  }
+  if (userPageTables > userPageTablePeak){
+    userPageTablePeak = userPageTables;
+  }
+  int user = getUserFrames();
+  if (user > userFramePeak){
+    userFramePeak = user;
+  }
+}
+
+/******************** makeRoom ********************/
+/*
+ * get free frames (zero pool included) up to count, first
+ *  by reclaiming and then by killing processes
+ *
+ * input:
+ *  count - frames needed
+ *
+ * output:
+ *  return 0 if count frames are free
+ *  return ERROR if not even killing would free enough (or
+ *   the only process left to kill is the running one)
+ *
+ */
+int
+makeRoom(int count)
+{
+  while (mem_reclaimFrames(count, 1) < count){
+    //only kill if it can actually cover what's missing
+    int reclaimable = 0;
+    pcb_t* victim = pickOOMVictim(&reclaimable);
+    if (victim == NULL || freeFrames + zeroPoolCount + reclaimable < count){
+      TracePrintf(1, "makeRoom: out of memory, %d frames short and nothing worth killing\n", count - freeFrames - zeroPoolCount);
+      return ERROR;
+    }
+
+    TracePrintf(0, "OUT OF MEMORY: killing process %d (%d resident pages, working set %d)\n", victim->pid, mem_getResidentPages(victim), victim->workingSet);
+    oomKills++;
+    coord_removeProcess(victim, READY);
+    coord_abort(victim, ERROR);
+  }
+
+  return 0;
+}
+
+/******************** pickOOMVictim ********************/
+/*
+ * pick the process to kill when out of memory: the one with
+ *  the most resident pages (outside its working set counting
+ *  twice) that can safely be killed right now (ready to run,
+ *  not in the middle of a kernel call)
+ *
+ * input:
+ *  reclaimable - set to resident pages of every process that
+ *   could be killed
+ *
+ * output:
+ *  return victim, NULL if no one can be killed
+ *
+ * notes:
+ *  init is never picked (it exiting halts the system), and
+ *  neither is the running process (its caller gets ERROR
+ *  and fails or aborts it the usual way)
+ *
+ */
+pcb_t*
+pickOOMVictim(int* reclaimable)
+{
+  pcb_t* victim = NULL;
+  int victimScore = 0;
+  *reclaimable = 0;
+
+  for (int level = 0; level < MLFQ_LEVELS; level++){
+    for (pcb_t* pcb = processes->ready[level].head; pcb != NULL; pcb = pcb->next){
+      if (pcb->pid == 0 || pcb->pinned || pcb == coord_getIdlePCB()){
+        continue;
+      }
+
+      //pages it hasn't touched lately count double, killing an
+      //idle hog hurts less than killing a busy one
+      int pages = mem_getResidentPages(pcb);
+      *reclaimable += pages;
+      int cold = pages - pcb->workingSet;
+      int score = pages + (cold > 0 ? cold : 0);
+      if (score > victimScore){
+        victim = pcb;
+        victimScore = score;
+      }
+    }
+  }
+
+  return victim;
+}
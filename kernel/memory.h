@@ -12,6 +12,7 @@
 #include "ykernel.h"
 #include "structs.h"
 #include "traps.h"
+#include "memstats.h"
 
 /***************** mem_initFrameVector *****************/
 /*
@@ -78,7 +79,8 @@ int mem_isUsedFrame(int frameNumber);
 
 /******************* mem_freeFrame *******************/
 /*
- * marks the frame as unused 
+ * drops a reference to the frame, marking it as unused
+ *  once no one else maps it
  *
  * input:
  *  frameNumber - frame number to mark as unused 
@@ -97,8 +99,7 @@ int mem_freeFrame(int frameNumber);
 
 /******************* mem_getFreeFrame *******************/
 /*
- * return a random (the first) free frame to the user
- *  and mark it as in use
+ * return a free frame to the user and mark it as in use
  *
  * input:
  *  none
@@ -107,6 +108,11 @@ int mem_freeFrame(int frameNumber);
  *  return integer value of frame # if one available
  *  return ERROR if no free frames
  *
+ * notes:
+ *  scans the bit vector a word at a time, skipping full
+ *  words, and resumes from the word the last frame came
+ *  from (next fit)
+ *
  */
 
 //-------------------------------------------------------
@@ -115,6 +121,389 @@ int mem_getFreeFrame();
 
 //-------------------------------------------------------
 
+/******************* mem_getFreeFrameCount *******************/
+/*
+ * return how many frames are currently unused
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  number of free frames
+ *
+ * notes:
+ *  kept as a running count, so callers can cheaply check
+ *  capacity before starting a fork or exec
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_getFreeFrameCount();
+
+//-------------------------------------------------------
+
+/******************* mem_allocFrame *******************/
+/*
+ * return a free frame for a user page, reclaiming (see
+ *  mem_reclaimFrames) if memory is full, and killing the
+ *  ready process with the most resident pages if even
+ *  that comes up empty
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  return integer value of frame # if one available
+ *  return ERROR if no frame free and no one left to kill
+ *
+ * notes:
+ *  may block the running process (see swap_evict), so
+ *  only call from process context, never from SetKernelBrk
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_allocFrame();
+
+//-------------------------------------------------------
+
+/******************* mem_getFrameRefs *******************/
+/*
+ * number of ptes (and other holders) sharing a frame
+ *
+ * input:
+ *  frame - frame to check
+ *
+ * output:
+ *  reference count of frame (0 if free)
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_getFrameRefs(int frame);
+
+//-------------------------------------------------------
+
+/******************* mem_readFrame *******************/
+/*
+ * copy a frame's contents out to kernel memory
+ *
+ * input:
+ *  frame - frame to copy from
+ *  dst - PAGESIZE region 0 buffer to copy to
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_readFrame(int frame, void* dst);
+
+//-------------------------------------------------------
+
+/******************* mem_mapWindow *******************/
+/*
+ * map a batch of frames into the kernel copy window, the
+ *  region 0 pages just under the kernel stack
+ *
+ * input:
+ *  frameList - frames to map, in order
+ *  count - number of frames (at most COPY_WINDOW_SLOTS)
+ *
+ * output:
+ *  return kernel address of the first frame (the rest
+ *   follow contiguously)
+ *
+ * notes:
+ *  only one batch can be mapped at a time, and the kernel
+ *  must not block while it's mapped
+ *
+ */
+
+//-------------------------------------------------------
+
+void* mem_mapWindow(int* frameList, int count);
+
+//-------------------------------------------------------
+
+/******************* mem_unmapWindow *******************/
+/*
+ * unmap the copy window after mem_mapWindow, flushing only
+ *  the slots that were used from the tlb
+ *
+ * input:
+ *  count - number of frames that were mapped
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  one flush per slot, so a batch costs as many flushes as
+ *  mapping its frames one at a time would. the hardware can
+ *  only flush one page or a whole region, and flushing all of
+ *  region 0 throws away the kernel's own entries too. batching
+ *  only saves the page table updates and calls
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_unmapWindow(int count);
+
+//-------------------------------------------------------
+
+/******************* mem_writeFrame *******************/
+/*
+ * copy kernel memory into a frame
+ *
+ * input:
+ *  frame - frame to copy to
+ *  src - PAGESIZE region 0 buffer to copy from
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_writeFrame(int frame, void* src);
+
+//-------------------------------------------------------
+
+/******************* mem_getZeroedFrame *******************/
+/*
+ * return a frame full of zeros and mark it as in use
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  return integer value of frame # if one available
+ *  return ERROR if no free frames
+ *
+ * notes:
+ *  takes a frame from the zero pool when there is one,
+ *  otherwise zeroes a free frame on the spot
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_getZeroedFrame();
+
+//-------------------------------------------------------
+
+/******************* mem_fillZeroPool *******************/
+/*
+ * zero free frames ahead of time and keep them in the
+ *  zero pool (up to ZERO_POOL_SIZE)
+ *
+ * input:
+ *  count - most frames to zero this call
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  meant for time the cpu would otherwise spend idle.
+ *  pool frames still count as free, anyone short on
+ *  frames takes them back
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_fillZeroPool(int count);
+
+//-------------------------------------------------------
+
+/******************* mem_getZeroPoolStats *******************/
+/*
+ * report on the zero pool
+ *
+ * input:
+ *  size - filled with frames currently in pool
+ *  hits - filled with zeroed frame requests the pool served
+ *  misses - filled with zeroed frame requests that zeroed on the spot
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_getZeroPoolStats(int* size, int* hits, int* misses);
+
+//-------------------------------------------------------
+
+/******************* mem_initZeroFrame *******************/
+/*
+ * set aside one zeroed frame to back untouched heap pages
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  return 0 if successful
+ *  return ERROR if no frame available
+ *
+ * notes:
+ *  must be called after vmem is enabled
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_initZeroFrame();
+
+//-------------------------------------------------------
+
+/******************* mem_mapZeroPages *******************/
+/*
+ * map count pages starting at firstPage to the shared zero
+ *  frame, read only, to be given real frames on first write
+ *
+ * input:
+ *  pcb - process to map pages in
+ *  firstPage - first page to map
+ *  count - number of pages to map
+ *
+ * output:
+ *  return 0 if successful
+ *  return ERROR if pages out of range (nothing mapped)
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_mapZeroPages(pcb_t* pcb, int firstPage, int count);
+
+//-------------------------------------------------------
+
+/******************* mem_mergePage *******************/
+/*
+ * make a page share the frame of an identical page, copy
+ *  on write for both, dropping the frame it had
+ *
+ * input:
+ *  owner - process holding the frame to keep (NULL if the
+ *   page is all zeros, to share the zero frame)
+ *  ownerPage - owner's page mapping that frame
+ *  pcb - process whose page gives up its frame
+ *  page - page to repoint
+ *
+ * output:
+ *  return 1 if the old frame was freed
+ *  return 0 if something else still maps it
+ *
+ * notes:
+ *  neither process may be running, their tlb entries are
+ *   only flushed when they're switched back in. caller
+ *   checks the contents really match
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_mergePage(pcb_t* owner, int ownerPage, pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/******************* mem_shareFrame *******************/
+/*
+ * add a reference to a frame that is already in use, so
+ *  it can be mapped into another page table
+ *
+ * input:
+ *  frameNumber - frame number to share
+ *
+ * output:
+ *  return 0 if successful
+ *  return ERROR if frame is not in use
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_shareFrame(int frameNumber);
+
+//-------------------------------------------------------
+
+/******************* mem_reserveFrames *******************/
+/*
+ * reserve count free frames in one pass over the frame
+ *  vector, marking them all as in use
+ *
+ * input:
+ *  frameList - array (at least count long) to fill with frame #s
+ *  count - number of frames wanted
+ *
+ * output:
+ *  return 0 if all count frames were reserved
+ *  return ERROR if not enough free frames (nothing reserved)
+ *
+ * notes:
+ *  reclaims and kills to make room the same way as
+ *  mem_allocFrame, but only kills if that could cover count
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_reserveFrames(int* frameList, int count);
+
+//-------------------------------------------------------
+
+/******************* mem_releaseFrames *******************/
+/*
+ * give back a list of frames (undo of mem_reserveFrames)
+ *
+ * input:
+ *  frameList - frame #s to free
+ *  count - number of frames in list
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_releaseFrames(int* frameList, int count);
+
+//-------------------------------------------------------
+
+/******************* mem_mapUserPages *******************/
+/*
+ * install count consecutive ptes starting at firstPage, each
+ *  pointing at the next frame in frameList
+ *
+ * input:
+ *  pt - page table to update
+ *  firstPage - first page to map
+ *  count - number of pages to map
+ *  prot - the prot to give each page
+ *  frameList - frames (from mem_reserveFrames) to map in
+ *
+ * output:
+ *  return 0 if successful 
+ *  return ERROR if pages out of range (nothing mapped)
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_mapUserPages(pte_t* pt, int firstPage, int count, u_long prot, int* frameList);
+
+//-------------------------------------------------------
+
 /******************* mem_initKernelPT *******************/
 /*
  * create and store the kernel page table with correct perms
@@ -163,6 +552,11 @@ int mem_loadKernelStack(pcb_t* pcb);
  *
  * output:
  *  return 0 if successfully modified kernel stack
+ *  return ERROR if no frames
+ *
+ * notes:
+ *  takes the most recently freed stack from the kernel
+ *  stack cache first (mem_freePCB fills it)
  *
  */
 
@@ -234,13 +628,18 @@ int mem_initUserStack(pte_t* pt);
  * copy the page table from one process to the next
  *
  * input:
- *  proc1 - pcb to copy pt from 
+ *  proc1 - pcb to copy pt from (must be running process)
  *  proc2 - pcb to copy pt to
  *
  * output:
  *  return 0 if successful 
  *  return ERROR if unsuccessful 
  *
+ * notes:
+ *  frames are shared, not copied. writable pages are made
+ *  read only copy on write in both processes and only get
+ *  copied in mem_handleWriteFault
+ *
  */
 
 //-------------------------------------------------------
@@ -249,6 +648,32 @@ int mem_copyPT(pcb_t* proc1, pcb_t* proc2);
 
 //-------------------------------------------------------
 
+/******************* mem_handleWriteFault *******************/
+/*
+ * try to resolve a write to a read only page of a process
+ *
+ * input:
+ *  pcb - process that wrote (must be running process)
+ *  page - region 1 page written to
+ *
+ * output:
+ *  return 1 if page is now writable
+ *  return 0 if page is not supposed to be writable
+ *  return ERROR if no frame to copy into
+ *
+ * notes:
+ *  copy on write pages get their own frame unless this
+ *  process is the last one using it, untouched heap pages
+ *  trade the zero frame for a freshly zeroed one
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_handleWriteFault(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
 /******************* mem_setUserPTE *******************/
 /*
  * set page # of pt to have prot perms
@@ -275,17 +700,148 @@ int mem_setUserPTE(pte_t* pt, int page, u_long prot);
  * return the first unused page below stack
  *
  * input:
- *  pt - page table to get stack brk of
+ *  pcb - process to get stack brk of
  *
  * output:
  *  return stack brk if successful
  *  return ERROR if failed
  *
+ * notes:
+ *  this is the page right under the stack region
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_getStackBrk(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/******************* mem_growStack *******************/
+/*
+ * map zeroed pages under the stack til it reaches page,
+ *  growing the stack region to match
+ *
+ * input:
+ *  pcb - process whose stack grows
+ *  page - lowest page the stack needs
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if out of frames (pages mapped so far stay)
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_growStack(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/******************* mem_addVMA *******************/
+/*
+ * add a region to a process's address space (pages
+ *  themselves are mapped by the caller)
+ *
+ * input:
+ *  pcb - process to add region to
+ *  type - kind of region (VMA_TEXT, VMA_HEAP, ...)
+ *  firstPage - first page of region
+ *  numPages - size of region (heap starts out empty)
+ *  prot - protection of the region's pages
+ *
+ * output:
+ *  return new region
+ *  return NULL if process already has MAX_VMAS regions
+ *
  */
 
 //-------------------------------------------------------
 
-int mem_getStackBrk(pte_t* pt);
+vma_t* mem_addVMA(pcb_t* pcb, int type, int firstPage, int numPages, u_long prot);
+
+//-------------------------------------------------------
+
+/******************* mem_removeVMA *******************/
+/*
+ * drop a region from a process (its pages should
+ *  already be unmapped)
+ *
+ * input:
+ *  pcb - process to remove region from
+ *  vma - region to remove
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  moves other regions around, so pointers to the
+ *  process's regions aren't good after this
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_removeVMA(pcb_t* pcb, vma_t* vma);
+
+//-------------------------------------------------------
+
+/******************* mem_findVMA *******************/
+/*
+ * find region a page falls in
+ *
+ * input:
+ *  pcb - process to look in
+ *  page - region 1 page number
+ *
+ * output:
+ *  return region holding page
+ *  return NULL if page isn't in any region
+ *
+ */
+
+//-------------------------------------------------------
+
+vma_t* mem_findVMA(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/******************* mem_getVMA *******************/
+/*
+ * find a process's region of some type
+ *
+ * input:
+ *  pcb - process to look in
+ *  type - kind of region (first one if there's several)
+ *
+ * output:
+ *  return region
+ *  return NULL if process has none of that type
+ *
+ */
+
+//-------------------------------------------------------
+
+vma_t* mem_getVMA(pcb_t* pcb, int type);
+
+//-------------------------------------------------------
+
+/******************* mem_freeRegions *******************/
+/*
+ * unmap every page in a process's regions, freeing frames
+ *  and swap slots, and drop all its regions
+ *
+ * input:
+ *  pcb - process to empty out (pt itself is kept)
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_freeRegions(pcb_t* pcb);
 
 //-------------------------------------------------------
 
@@ -345,6 +901,225 @@ void mem_freePT(pte_t* pt);
 
 //-------------------------------------------------------
 
+/******************* mem_freeAddressSpace *******************/
+/*
+ * give back a process's region 1 memory: frames, swap
+ *  slots, shared segments and program file
+ *
+ * input:
+ *  pcb - process that's done with its address space
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  the pt itself stays (empty) til mem_freePCB, the
+ *  mmu may still point at it if pcb is running
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_freeAddressSpace(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/******************* mem_reclaimFrames *******************/
+/*
+ * get frames back til free frames (zero pool included)
+ *  reach target: free dead processes, drop cached kernel
+ *  stacks and unused program text, then page out (into the
+ *  compressed store if the page shrinks, else to disk)
+ *
+ * input:
+ *  target - free frames wanted
+ *  canSwap - 1 if pages can be paged out to disk to reach it
+ *   (the compressed store never blocks, so it's always used)
+ *
+ * output:
+ *  return free frames after reclaiming (may be under target)
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_reclaimFrames(int target, int canSwap);
+
+//-------------------------------------------------------
+
+/******************* mem_checkWatermarks *******************/
+/*
+ * reclaim back up to FRAMES_HIGH_WATER if free frames have
+ *  dropped under FRAMES_LOW_WATER (called every clock tick)
+ *
+ * input:
+ *  canSwap - 1 if pages can be paged out to disk
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  never kills anything, that only happens when an
+ *  allocation can't be met (see mem_allocFrame)
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_checkWatermarks(int canSwap);
+
+//-------------------------------------------------------
+
+/******************* mem_getResidentPages *******************/
+/*
+ * count pages of a process that hold a frame (pages still
+ *  on the zero frame don't count)
+ *
+ * input:
+ *  pcb - process to count
+ *
+ * output:
+ *  return number of resident pages
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_getResidentPages(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/******************* mem_deferFreePCB *******************/
+/*
+ * put a dead process on the reclaim list, to be freed by
+ *  mem_drainReclaim later instead of right now
+ *
+ * input:
+ *  pcb - process no one will touch again (on no queue),
+ *   address space already given back by coord_abort, so
+ *   only its pcb, page table and kernel stack wait
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_deferFreePCB(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/******************* mem_drainReclaim *******************/
+/*
+ * free dead processes off the reclaim list, oldest first
+ *
+ * input:
+ *  count - most processes to free
+ *
+ * output:
+ *  return number of processes freed
+ *
+ * notes:
+ *  the clock handler drains RECLAIM_BATCH a tick
+ *  (RECLAIM_IDLE_BATCH when idle), and running out of
+ *  frames drains the whole list
+ *
+ */
+
+//-------------------------------------------------------
+
+int mem_drainReclaim(int count);
+
+//-------------------------------------------------------
+
+/******************* mem_getReclaimStats *******************/
+/*
+ * get reclaim list stats
+ *
+ * input:
+ *  pending - set to processes on list now
+ *  highWater - set to longest the list has been
+ *  freed - set to processes freed off the list
+ *  maxWait - set to most ticks a process waited to be freed
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_getReclaimStats(int* pending, int* highWater, int* freed, int* maxWait);
+
+//-------------------------------------------------------
+
+/******************* mem_addKernelHeapFrames *******************/
+/*
+ * count frames given to (or taken from) the kernel heap
+ *
+ * input:
+ *  count - frames added, negative if removed
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  count frames before taking them so they never show up
+ *   as user frames in the stats. in practice the heap only
+ *   grows: pcbs, pipes, locks and cvars live in slabs that
+ *   stay malloced til slab_exit (see slab.h), so frames
+ *   given to the heap for them don't come back while the
+ *   kernel runs
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_addKernelHeapFrames(int count);
+
+//-------------------------------------------------------
+
+/******************* mem_getStats *******************/
+/*
+ * report how physical memory is split up right now, with
+ *  high-water marks, how fragmented the free frames are and
+ *  the running process's working set
+ *
+ * input:
+ *  stats - filled with MEMSTAT_COUNT ints laid out as in
+ *   memstats.h
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_getStats(int* stats);
+
+//-------------------------------------------------------
+
+/******************* mem_traceStats *******************/
+/*
+ * print mem_getStats to the trace
+ *
+ * input:
+ *  level - trace level to print at
+ *  when - label for the snapshot (e.g. "at halt")
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void mem_traceStats(int level, char* when);
+
+//-------------------------------------------------------
+
 /******************* mem_freePCB *******************/
 /*
  * free pcb and all contents inside
@@ -0,0 +1,44 @@
+/*
+ * file: memstats.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  layout of the physical memory stats filled in by
+ *   Custom1(buf, count, 0, 0), shared with user programs
+ *   (so no kernel includes here)
+ *
+ *  every stat is a count of frames unless noted, and
+ *   total = free + kernel heap + kernel stacks + user + cached
+ */
+
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#define MEMSTAT_TOTAL 0 //frames of physical memory
+#define MEMSTAT_FREE 1 //unused frames (zero pool counts as free)
+#define MEMSTAT_FREE_LOW 2 //fewest free frames there have been
+#define MEMSTAT_KHEAP 3 //kernel text, data and heap
+#define MEMSTAT_KHEAP_PEAK 4
+#define MEMSTAT_KSTACK 5 //kernel stacks of live processes
+#define MEMSTAT_KSTACK_PEAK 6
+#define MEMSTAT_PTABLE 7 //user page tables (count, they live in the kernel heap)
+#define MEMSTAT_PTABLE_PEAK 8
+#define MEMSTAT_USER 9 //user pages, shared segments and cached program text
+#define MEMSTAT_USER_PEAK 10
+#define MEMSTAT_CACHED 11 //cached kernel stacks, the zero frame and compressed store frames
+#define MEMSTAT_FREE_RUNS 12 //stretches of consecutive free frames
+#define MEMSTAT_LARGEST_RUN 13 //longest stretch of consecutive free frames
+#define MEMSTAT_DEDUP_SCANNED 14 //pages the dedup scanner has hashed
+#define MEMSTAT_DEDUP_MERGED 15 //pages it pointed at an identical frame
+#define MEMSTAT_DEDUP_SAVED 16 //frames freed by merging
+#define MEMSTAT_ZCACHE_FRAMES 17 //frames the compressed store holds
+#define MEMSTAT_ZCACHE_PAGES 18 //paged out pages kept in them
+#define MEMSTAT_ZCACHE_BYTES 19 //bytes those pages compressed to
+#define MEMSTAT_WS_ROUNDS 20 //times the working set sampler has run
+#define MEMSTAT_WS_FAULTS 21 //sampled pages touched before the next round
+#define MEMSTAT_WS_SELF 22 //pages the caller touched lately (its working set)
+#define MEMSTAT_ZCACHE_STORES 23 //pages compressed into the store since boot (count)
+#define MEMSTAT_ZCACHE_LOADS 24 //pages decompressed back out of it since boot (count)
+#define MEMSTAT_COUNT 25
+
+#endif
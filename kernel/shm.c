@@ -0,0 +1,382 @@
+/*
+ * file: shm.c
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  shared memory segments, the same frames mapped into the
+ *  region 1 page tables of several processes
+ */
+
+#include <ykernel.h>
+#include "shm.h"
+#include "memory.h"
+#include "codes.h"
+#include "structs.h"
+
+/***************** globals *****************/
+shm_t* segments; //every live segment (named and anonymous)
+int segmentsCreated;
+int segmentAttaches;
+
+/******************* local funcs *******************/
+shm_t* findSegment(int key);
+shm_t* newSegment(int key, int numPages);
+void destroySegment(shm_t* seg);
+int findRange(pcb_t* pcb, int numPages);
+int mapSegment(pcb_t* pcb, shm_t* seg, int firstPage, int numPages);
+
+/***************** shm_attach *****************/
+/*
+ * see shm.h for description
+ */
+int
+shm_attach(pcb_t* pcb, int key, int numPages)
+{
+  TracePrintf(5, "ENTER shm_attach (key %d, %d pages)\n", key, numPages);
+
+  if (pcb == NULL || numPages < 0 || numPages > MAX_PT_LEN || (key == SHM_ANON && numPages == 0)){
+    TracePrintf(1, "shm_attach: bad segment size %d\n", numPages);
+    return ERROR;
+  }
+
+  //attaching only maps as much of the segment as asked for
+  shm_t* seg = findSegment(key);
+  if (seg == NULL && numPages == 0){
+    TracePrintf(1, "shm_attach: segment %d doesn't exist\n", key);
+    return ERROR;
+  }
+  if (seg != NULL && numPages == 0){
+    numPages = seg->numPages;
+  }
+  if (seg != NULL && numPages > seg->numPages){
+    TracePrintf(1, "shm_attach: segment %d only has %d pages\n", key, seg->numPages);
+    return ERROR;
+  }
+
+  int firstPage = findRange(pcb, numPages);
+  if (firstPage == ERROR){
+    TracePrintf(1, "shm_attach: no room for %d pages in process %d\n", numPages, pcb->pid);
+    return ERROR;
+  }
+
+  if (seg == NULL){
+    //getting frames may have blocked, someone else could have made it meanwhile
+    shm_t* made = newSegment(key, numPages);
+    seg = findSegment(key);
+    if (made == NULL && seg == NULL){
+      TracePrintf(1, "shm_attach: couldn't make segment %d\n", key);
+      return ERROR;
+    }
+    if (seg == NULL || key == SHM_ANON){
+      seg = made;
+      seg->next = segments;
+      segments = seg;
+    } else if (made != NULL){
+      destroySegment(made);
+    }
+    if (numPages > seg->numPages){
+      TracePrintf(1, "shm_attach: segment %d only has %d pages\n", key, seg->numPages);
+      return ERROR;
+    }
+  }
+
+  if (mapSegment(pcb, seg, firstPage, numPages) == ERROR){
+    //a segment no one ever mapped goes right back
+    if (seg->attached == 0){
+      destroySegment(seg);
+    }
+    return ERROR;
+  }
+
+  segmentAttaches++;
+
+  TracePrintf(5, "EXIT shm_attach (page %d)\n", firstPage);
+  return firstPage;
+}
+
+/***************** shm_fork *****************/
+/*
+ * see shm.h for description
+ */
+int
+shm_fork(pcb_t* parent, pcb_t* child)
+{
+  TracePrintf(5, "ENTER shm_fork\n");
+
+  shmMap_t** tail = &(child->shm);
+  for (shmMap_t* map = parent->shm; map != NULL; map = map->next){
+    shmMap_t* copy = malloc(sizeof(shmMap_t));
+    if (copy == NULL){
+      TracePrintf(1, "shm_fork: no memory for child mapping\n");
+      return ERROR;
+    }
+    copy->seg = map->seg;
+    copy->firstPage = map->firstPage;
+    copy->numPages = map->numPages;
+    copy->next = NULL;
+    map->seg->attached++;
+
+    *tail = copy;
+    tail = &(copy->next);
+  }
+
+  TracePrintf(5, "EXIT shm_fork\n");
+  return 0;
+}
+
+/***************** shm_detachAll *****************/
+/*
+ * see shm.h for description
+ */
+void
+shm_detachAll(pcb_t* pcb)
+{
+  TracePrintf(5, "ENTER shm_detachAll\n");
+
+  if (pcb == NULL){
+    return;
+  }
+
+  shmMap_t* map = pcb->shm;
+  while (map != NULL){
+    shmMap_t* next = map->next;
+
+    //drop this process's refs on the frames
+    if (pcb->pt != NULL){
+      for (int page = map->firstPage; page < map->firstPage + map->numPages; page++){
+        if (pcb->pt[page].valid){
+          mem_freePTE(pcb->pt, page);
+        }
+        pcb->pageFlags[page] = 0;
+      }
+    }
+
+    //region goes with it
+    vma_t* vma = mem_findVMA(pcb, map->firstPage);
+    if (vma != NULL && vma->type == VMA_SHARED){
+      mem_removeVMA(pcb, vma);
+    }
+
+    map->seg->attached--;
+    if (map->seg->attached == 0){
+      destroySegment(map->seg);
+    }
+    free(map);
+    map = next;
+  }
+  pcb->shm = NULL;
+
+  WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
+
+  TracePrintf(5, "EXIT shm_detachAll\n");
+}
+
+/***************** shm_overlaps *****************/
+/*
+ * see shm.h for description
+ */
+int
+shm_overlaps(pcb_t* pcb, int firstPage, int lastPage)
+{
+  for (shmMap_t* map = pcb->shm; map != NULL; map = map->next){
+    int segLast = map->firstPage + map->numPages - 1;
+    if (map->firstPage <= lastPage && segLast >= firstPage){
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/***************** shm_exit *****************/
+/*
+ * see shm.h for description
+ */
+void
+shm_exit()
+{
+  TracePrintf(1, "shm: %d segments made, %d attaches\n", segmentsCreated, segmentAttaches);
+
+  //every process is gone, so nothing still maps these
+  while (segments != NULL){
+    destroySegment(segments);
+  }
+}
+
+/******************** findSegment ********************/
+/*
+ * find a named segment
+ *
+ * input:
+ *  key - name of segment
+ *
+ * output:
+ *  return segment, NULL if no such segment (or key is SHM_ANON)
+ *
+ */
+shm_t*
+findSegment(int key)
+{
+  if (key == SHM_ANON){
+    return NULL;
+  }
+
+  for (shm_t* seg = segments; seg != NULL; seg = seg->next){
+    if (seg->key == key){
+      return seg;
+    }
+  }
+
+  return NULL;
+}
+
+/******************** newSegment ********************/
+/*
+ * make a segment backed by zeroed frames (not on the
+ *  segment list yet)
+ *
+ * input:
+ *  key - name of segment
+ *  numPages - size of segment
+ *
+ * output:
+ *  return segment, NULL if out of memory
+ *
+ */
+shm_t*
+newSegment(int key, int numPages)
+{
+  shm_t* seg = malloc(sizeof(shm_t));
+  if (seg == NULL){
+    return NULL;
+  }
+  seg->frames = malloc(sizeof(int) * numPages);
+  if (seg->frames == NULL){
+    free(seg);
+    return NULL;
+  }
+
+  for (int page = 0; page < numPages; page++){
+    seg->frames[page] = mem_getZeroedFrame();
+    if (seg->frames[page] == ERROR){
+      mem_releaseFrames(seg->frames, page);
+      free(seg->frames);
+      free(seg);
+      return NULL;
+    }
+  }
+
+  seg->key = key;
+  seg->numPages = numPages;
+  seg->attached = 0;
+  seg->next = NULL;
+  segmentsCreated++;
+
+  return seg;
+}
+
+/******************** destroySegment ********************/
+/*
+ * free a segment and its frames (taking it off the
+ *  segment list if it's on it)
+ *
+ * input:
+ *  seg - segment no one has mapped
+ *
+ * output:
+ *  none
+ *
+ */
+void
+destroySegment(shm_t* seg)
+{
+  for (shm_t** link = &segments; *link != NULL; link = &((*link)->next)){
+    if (*link == seg){
+      *link = seg->next;
+      break;
+    }
+  }
+
+  mem_releaseFrames(seg->frames, seg->numPages);
+  free(seg->frames);
+  free(seg);
+}
+
+/******************** findRange ********************/
+/*
+ * find unused pages to map a segment at, working down
+ *  from just under the stack's growing room
+ *
+ * input:
+ *  pcb - process to map into
+ *  numPages - pages needed
+ *
+ * output:
+ *  return first page of range, ERROR if no room
+ *
+ */
+int
+findRange(pcb_t* pcb, int numPages)
+{
+  int top = mem_getStackBrk(pcb) - SHM_STACK_GAP;
+
+  //keep a red zone page over the heap
+  int run = 0;
+  for (int page = top; page > pcb->brk; page--){
+    if (pcb->pt[page].valid == 0 && pcb->pageFlags[page] == 0){
+      run++;
+    } else {
+      run = 0;
+    }
+    if (run == numPages){
+      return page;
+    }
+  }
+
+  return ERROR;
+}
+
+/******************** mapSegment ********************/
+/*
+ * map the first numPages of a segment into a process
+ *
+ * input:
+ *  pcb - process to map into
+ *  seg - segment to map
+ *  firstPage - where to map it (pages are free)
+ *  numPages - pages to map
+ *
+ * output:
+ *  return 0 on success, ERROR if out of memory
+ *
+ */
+int
+mapSegment(pcb_t* pcb, shm_t* seg, int firstPage, int numPages)
+{
+  shmMap_t* map = malloc(sizeof(shmMap_t));
+  if (map == NULL){
+    return ERROR;
+  }
+  if (mem_addVMA(pcb, VMA_SHARED, firstPage, numPages, (PROT_READ | PROT_WRITE)) == NULL){
+    free(map);
+    return ERROR;
+  }
+
+  for (int i = 0; i < numPages; i++){
+    int page = firstPage + i;
+    mem_shareFrame(seg->frames[i]);
+    pcb->pt[page].pfn = seg->frames[i];
+    pcb->pt[page].prot = (PROT_READ | PROT_WRITE);
+    pcb->pt[page].valid = 1;
+    pcb->pageFlags[page] = PAGE_SHARED;
+  }
+
+  map->seg = seg;
+  map->firstPage = firstPage;
+  map->numPages = numPages;
+  map->next = pcb->shm;
+  pcb->shm = map;
+  seg->attached++;
+
+  return 0;
+}
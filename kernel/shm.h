@@ -0,0 +1,125 @@
+/*
+ * file: shm.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  interface for shm.c (shared memory segments)
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+#include <ykernel.h>
+#include "codes.h"
+#include "structs.h"
+
+/********************* shm_attach *********************/
+/*
+ * map a shared memory segment into a process, creating
+ *  it first if it doesn't exist yet
+ *
+ * input: 
+ *  pcb - process to map segment into
+ *  key - name of segment (SHM_ANON for a new unnamed one)
+ *  numPages - pages in segment (attaching maps the first
+ *   numPages of an existing segment, 0 maps all of it)
+ *
+ * output:
+ *  return region 1 page the segment starts at
+ *  return ERROR if segment can't be made or there's no room
+ *   for it between heap and stack
+ *
+ * notes:
+ *  new segments read as zero. the segment is placed under
+ *  the stack, leaving SHM_STACK_GAP pages for stack growth
+ *
+ */
+
+//-------------------------------------------------------
+
+int shm_attach(pcb_t* pcb, int key, int numPages);
+
+//-------------------------------------------------------
+
+/********************* shm_fork *********************/
+/*
+ * give a child the parent's segments (mem_copyPT has
+ *  already mapped the pages themselves)
+ *
+ * input: 
+ *  parent - process forking
+ *  child - new process
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if out of memory (child keeps the
+ *   segments it got, mem_freePCB lets go of them)
+ *
+ */
+
+//-------------------------------------------------------
+
+int shm_fork(pcb_t* parent, pcb_t* child);
+
+//-------------------------------------------------------
+
+/********************* shm_detachAll *********************/
+/*
+ * unmap every segment from a process, freeing segments
+ *  no one else has mapped
+ *
+ * input: 
+ *  pcb - process giving up its segments
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void shm_detachAll(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/********************* shm_overlaps *********************/
+/*
+ * check if any segment a process has mapped falls in a
+ *  range of pages
+ *
+ * input: 
+ *  pcb - process to check
+ *  firstPage - lowest page of range
+ *  lastPage - highest page of range (inclusive)
+ *
+ * output:
+ *  return 1 if some segment page is in range
+ *  return 0 if not
+ *
+ */
+
+//-------------------------------------------------------
+
+int shm_overlaps(pcb_t* pcb, int firstPage, int lastPage);
+
+//-------------------------------------------------------
+
+/********************* shm_exit *********************/
+/*
+ * report shared memory stats and free any segments left
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void shm_exit();
+
+//-------------------------------------------------------
+
+#endif //SHM_H
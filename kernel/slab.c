@@ -0,0 +1,283 @@
+/*
+ * file: slab.c
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  slab caches for kernel objects that come and go a lot
+ *  (pcbs, pipes, locks, cvars). each cache grows a page at
+ *  a time and recycles its own objects, so fork/exit churn
+ *  never goes back to the kernel heap. objects are
+ *  constructed once, when their slab is carved, and stay
+ *  constructed while free (the free list link lives in a
+ *  word in front of each object, not in the object)
+ */
+
+#include <ykernel.h>
+#include "slab.h"
+#include "codes.h"
+#include "structs.h"
+
+#define SLAB_HEADER 8 //room for the slab link, keeps objects 8 byte aligned
+#define SLOT_LINK 8 //room for the free list link in front of each object, same alignment
+#define SLAB_ALIGN(n) (((n) + 7) & ~7)
+
+/***************** globals *****************/
+slabCache_t pcbCache;
+slabCache_t pipeCache;
+slabCache_t lockCache;
+slabCache_t cvarCache;
+slabCache_t exitCache;
+
+/******************* local funcs *******************/
+void initCache(slabCache_t* cache, char* name, int objSize, void (*ctor)(void*));
+int growCache(slabCache_t* cache);
+void destroyCache(slabCache_t* cache);
+void pcbCtor(void* obj);
+void pipeCtor(void* obj);
+void lockCtor(void* obj);
+void cvarCtor(void* obj);
+void exitCtor(void* obj);
+
+/***************** slab_init *****************/
+/*
+ * see slab.h for description
+ */
+void
+slab_init()
+{
+  TracePrintf(5, "ENTER slab_init\n");
+
+  initCache(&pcbCache, "pcb", sizeof(pcb_t), pcbCtor);
+  initCache(&pipeCache, "pipe", sizeof(pipe_t), pipeCtor);
+  initCache(&lockCache, "lock", sizeof(lock_t), lockCtor);
+  initCache(&cvarCache, "cvar", sizeof(cvar_t), cvarCtor);
+  initCache(&exitCache, "exit record", sizeof(exitRecord_t), exitCtor);
+
+  TracePrintf(5, "EXIT slab_init\n");
+}
+
+/***************** slab_exit *****************/
+/*
+ * see slab.h for description
+ */
+void
+slab_exit()
+{
+  TracePrintf(5, "ENTER slab_exit\n");
+
+  destroyCache(&pcbCache);
+  destroyCache(&pipeCache);
+  destroyCache(&lockCache);
+  destroyCache(&cvarCache);
+  destroyCache(&exitCache);
+
+  TracePrintf(5, "EXIT slab_exit\n");
+}
+
+/***************** slab_alloc *****************/
+/*
+ * see slab.h for description
+ */
+void*
+slab_alloc(slabCache_t* cache)
+{
+  //every slab full, add another
+  if (cache->freeList == NULL && growCache(cache) == ERROR){
+    TracePrintf(1, "slab_alloc: no memory to grow %s cache\n", cache->name);
+    return NULL;
+  }
+
+  char* slot = cache->freeList;
+  cache->freeList = *(void**)slot;
+
+  //already constructed, the caller resets whatever it uses
+  void* obj = slot + SLOT_LINK;
+  cache->allocs++;
+  cache->inUse++;
+  if (cache->inUse > cache->highWater){
+    cache->highWater = cache->inUse;
+  }
+
+  return obj;
+}
+
+/***************** slab_free *****************/
+/*
+ * see slab.h for description
+ */
+void
+slab_free(slabCache_t* cache, void* obj)
+{
+  if (obj == NULL){
+    return;
+  }
+
+  char* slot = (char*)obj - SLOT_LINK;
+  *(void**)slot = cache->freeList;
+  cache->freeList = slot;
+
+  cache->frees++;
+  cache->inUse--;
+}
+
+/***************** slab_getStats *****************/
+/*
+ * see slab.h for description
+ */
+void
+slab_getStats(slabCache_t* cache, int* slabs, int* inUse, int* highWater)
+{
+  *slabs = cache->numSlabs;
+  *inUse = cache->inUse;
+  *highWater = cache->highWater;
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** initCache ********************/
+/*
+ * set up an empty cache
+ *
+ * input:
+ *  cache - cache to set up
+ *  name - name for stats
+ *  objSize - size of each object
+ *  ctor - starting state for objects, run once as their
+ *   slab is carved
+ *
+ */
+void
+initCache(slabCache_t* cache, char* name, int objSize, void (*ctor)(void*))
+{
+  cache->name = name;
+  cache->objSize = SLOT_LINK + SLAB_ALIGN(objSize);
+  cache->perSlab = (PAGESIZE - SLAB_HEADER) / cache->objSize;
+  cache->ctor = ctor;
+  cache->slabs = NULL;
+  cache->freeList = NULL;
+  cache->numSlabs = 0;
+  cache->inUse = 0;
+  cache->highWater = 0;
+  cache->allocs = 0;
+  cache->frees = 0;
+
+  TracePrintf(3, "slab: %s cache, %d byte objects, %d per slab\n", name, cache->objSize, cache->perSlab);
+}
+
+/******************** growCache ********************/
+/*
+ * add a slab to a cache, construct its objects and put
+ *  them all on the free list
+ *
+ * input:
+ *  cache - cache to grow
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if no memory
+ *
+ */
+int
+growCache(slabCache_t* cache)
+{
+  char* slab = malloc(PAGESIZE);
+  if (slab == NULL){
+    return ERROR;
+  }
+
+  //link slab into the cache
+  *(void**)slab = cache->slabs;
+  cache->slabs = slab;
+  cache->numSlabs++;
+
+  //construct every object and thread it onto the free list
+  for (int i = 0; i < cache->perSlab; i++){
+    char* slot = slab + SLAB_HEADER + i * cache->objSize;
+    cache->ctor(slot + SLOT_LINK);
+    *(void**)slot = cache->freeList;
+    cache->freeList = slot;
+  }
+
+  TracePrintf(3, "slab: %s cache grew to %d slabs\n", cache->name, cache->numSlabs);
+  return 0;
+}
+
+/******************** destroyCache ********************/
+/*
+ * print a cache's stats and free all its slabs
+ *
+ * input:
+ *  cache - cache to destroy
+ *
+ */
+void
+destroyCache(slabCache_t* cache)
+{
+  TracePrintf(1, "slab %s: %d slabs, %d in use, high water %d, %d allocs, %d frees\n",
+      cache->name, cache->numSlabs, cache->inUse, cache->highWater, cache->allocs, cache->frees);
+
+  void* slab = cache->slabs;
+  while (slab != NULL){
+    void* next = *(void**)slab;
+    free(slab);
+    slab = next;
+  }
+
+  cache->slabs = NULL;
+  cache->freeList = NULL;
+  cache->numSlabs = 0;
+}
+
+/******************** pcbCtor ********************/
+/*
+ * fresh pcb, waiting on nothing
+ */
+void
+pcbCtor(void* obj)
+{
+  memset(obj, 0, sizeof(pcb_t));
+}
+
+/******************** pipeCtor ********************/
+/*
+ * fresh pipe, empty with no lock
+ */
+void
+pipeCtor(void* obj)
+{
+  pipe_t* pipe = obj;
+  memset(pipe, 0, sizeof(pipe_t));
+  pipe->lock = -1;
+}
+
+/******************** lockCtor ********************/
+/*
+ * fresh lock, not held
+ */
+void
+lockCtor(void* obj)
+{
+  memset(obj, 0, sizeof(lock_t));
+}
+
+/******************** cvarCtor ********************/
+/*
+ * fresh cvar
+ */
+void
+cvarCtor(void* obj)
+{
+  memset(obj, 0, sizeof(cvar_t));
+}
+
+/******************** exitCtor ********************/
+/*
+ * fresh exit record, on no list
+ */
+void
+exitCtor(void* obj)
+{
+  memset(obj, 0, sizeof(exitRecord_t));
+}
@@ -0,0 +1,129 @@
+/*
+ * file: slab.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  interface for slab.c (object caches for pcbs, pipes, locks, cvars)
+ *
+ *  slabs are malloced a page at a time from the kernel heap and
+ *  only given back by slab_exit, so the kernel heap never shrinks
+ *  back below what the most objects ever live at once needed
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <ykernel.h>
+#include "codes.h"
+#include "structs.h"
+
+/******************* caches *******************/
+extern slabCache_t pcbCache;
+extern slabCache_t pipeCache;
+extern slabCache_t lockCache;
+extern slabCache_t cvarCache;
+extern slabCache_t exitCache;
+
+/********************* slab_init *********************/
+/*
+ * set up the object caches (no slabs until first alloc)
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void slab_init();
+
+//-------------------------------------------------------
+
+/********************* slab_exit *********************/
+/*
+ * report cache stats and give every slab back to the
+ *  kernel heap (all objects must be freed already)
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void slab_exit();
+
+//-------------------------------------------------------
+
+/********************* slab_alloc *********************/
+/*
+ * take an object from a cache, in its constructed state
+ *
+ * input: 
+ *  cache - cache to take from
+ *
+ * output:
+ *  return pointer to object
+ *  return NULL if out of memory
+ *
+ * notes:
+ *  only touches the kernel heap when every slab is full.
+ *  the constructor ran when the slab was carved, not now:
+ *  a recycled object holds whatever its last user left,
+ *  so callers reset the fields they use
+ *
+ */
+
+//-------------------------------------------------------
+
+void* slab_alloc(slabCache_t* cache);
+
+//-------------------------------------------------------
+
+/********************* slab_free *********************/
+/*
+ * give an object back to its cache
+ *
+ * input: 
+ *  cache - cache object came from
+ *  obj - object to free (NULL is fine)
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void slab_free(slabCache_t* cache, void* obj);
+
+//-------------------------------------------------------
+
+/********************* slab_getStats *********************/
+/*
+ * report on a cache
+ *
+ * input: 
+ *  cache - cache to report on
+ *  slabs - filled with number of slabs cache owns
+ *  inUse - filled with objects handed out right now
+ *  highWater - filled with most objects handed out at once
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void slab_getStats(slabCache_t* cache, int* slabs, int* inUse, int* highWater);
+
+//-------------------------------------------------------
+
+#endif
@@ -9,10 +9,127 @@
 #define STRUCTS_H
 
 #include "ykernel.h"
+#include "load_info.h"
 #include "codes.h"
 
 typedef unsigned long u_long;
 
+/*
+ * program file a process was loaded from, kept open so text and
+ *  data pages can be read in on first touch. images are cached by
+ *  path and file identity, so every process running the same
+ *  program shares one image and one copy of its text frames
+ */
+typedef struct image {
+  char* path; //name program was exec'd by
+  unsigned long dev; //file identity, a changed file is a new image
+  unsigned long ino;
+  long size;
+  long mtime;
+  int fd; //host file descriptor of program
+  struct load_info li; //where text and data live in the file
+  int* textFrames; //frame holding each text page, ERROR if not read in yet
+  int refs; //number of processes using the image
+  int stale; //file changed on disk, image dropped from cache
+  struct image* next; //next image in cache
+} image_t;
+
+/*
+ * shared memory segment, the same frames mapped into every process
+ *  that attaches it. named segments are found by key, anonymous ones
+ *  are only passed down through fork. a segment goes away when the
+ *  last process mapping it lets go
+ */
+typedef struct shm {
+  int key; //name processes attach by (SHM_ANON if unnamed)
+  int numPages;
+  int* frames; //frame backing each page (segment holds a ref on each)
+  int attached; //number of mappings of the segment
+  struct shm* next; //next segment in list
+} shm_t;
+
+/*
+ * a range of region 1 pages used for one thing (text, heap, ...).
+ *  every page a process can have mapped, paged out or waiting on
+ *  the program file falls in one of its vmas, so walks over the
+ *  address space only visit these ranges
+ */
+typedef struct vma {
+  int type; //VMA_TEXT, VMA_HEAP, ... (see codes.h)
+  int firstPage;
+  int numPages;
+  u_long prot; //protection pages get once they're really mapped
+} vma_t;
+
+/*
+ * where a process has a segment mapped
+ */
+typedef struct shmMap {
+  shm_t* seg;
+  int firstPage; //region 1 page the segment starts at
+  int numPages; //pages of the segment mapped
+  struct shmMap* next;
+} shmMap_t;
+
+/*
+ * a page in the compressed store, packed into consecutive chunks of
+ *  one store frame. forked children share entries like swap slots
+ */
+typedef struct zcacheEntry {
+  int store; //store frame holding it (ERROR if entry unused)
+  int firstChunk;
+  int numChunks;
+  int size; //compressed bytes
+  int refs; //number of ptes pointing at it
+} zcacheEntry_t;
+
+/*
+ * a user page the dedup scanner hashed, so a later page with the
+ *  same hash can be checked against it. entries go stale as pages
+ *  change, so owner and frame are rechecked before merging
+ */
+typedef struct dedupEntry {
+  unsigned int hash;
+  int frame; //frame the page had when hashed (ERROR if entry unused)
+  int pid; //process owning the page
+  int page;
+} dedupEntry_t;
+
+/*
+ * what's left of a child after it exits, kept til the parent
+ *  waits on it. the rest of the child is freed at exit
+ */
+typedef struct exitRecord {
+  int pid;
+  int status;
+  struct exitRecord* next; //next exited child
+} exitRecord_t;
+
+/*
+ * one pending timeout, kept on the timer wheel (see timer.c)
+ *  til its tick comes. embedded in whatever owns it, so arming
+ *  one never allocates
+ */
+typedef struct ktimer {
+  int expires; //clock tick it fires on
+  void (*fire)(struct ktimer*); //called from the clock handler once it expires
+  void* arg; //whatever fire needs
+  struct ktimer* next;
+  struct ktimer* prev;
+  struct ktimer** bucket; //wheel slot it's in, NULL if not armed
+} ktimer_t;
+
+/*
+ * queue of processes in one state, linked through the pcbs
+ *  themselves (next/prev) so adding, taking and unlinking
+ *  are all O(1)
+ */
+typedef struct pcbQueue {
+  struct pcb* head;
+  struct pcb* tail;
+  int count; //processes on the queue
+} pcbQueue_t;
+
 /*
  * The heart of our kernel, process control blocks that contain
  *  all the necessary information for any one process
@@ -22,22 +139,41 @@ struct pcb {
   struct pcb* parent; //parent pcb
   struct pcb* children; //first child (this is in place queue)
   struct pcb* next; //to give queue functionality
+  struct pcb* prev; //previous on its queue (queues are doubly linked)
+  pcbQueue_t* queue; //queue it's on, NULL if none (running or being freed)
+  struct pcb* waitNext; //next waiting on the same lock, cvar, pipe or tty
+  struct pcb* waitPrev;
+  pcbQueue_t* waitQueue; //that object's wait queue, NULL if none (see coord_blockOn)
   struct pcb* nextSibling; //queue functionality for siblings
+  struct pcb* prevSibling;
+  struct pcb* nextInTable; //next in its process table bucket
+  exitRecord_t* exitRecord; //handed to parent at exit (set up at fork so exit can't fail)
+  exitRecord_t* exited; //children that exited but haven't been waited on (oldest first)
   pte_t* pt; //page table
+  //per page state, left clean by mem_freeRegions so a recycled pcb keeps it
+  //(sys_fork zeroes everything around these three, keep them together)
+  int pageFlags[MAX_PT_LEN]; //software state for each region 1 page (see codes.h)
+  unsigned char pageAge[MAX_PT_LEN]; //sampling rounds each page went untouched in a row
+  unsigned char sampleProt[MAX_PT_LEN]; //real protection of PAGE_SAMPLED pages
+  int sampleCursor; //page the next sampling round starts at
+  int workingSet; //pages touched in the last WS_COLD_AGE rounds they were sampled
+  vma_t vmas[MAX_VMAS]; //regions of region 1 in use
+  int numVmas;
+  image_t* image; //program file backing lazily loaded pages
+  shmMap_t* shm; //shared memory segments mapped in
   int kstack[KERNEL_STACK_MAXSIZE/PAGESIZE]; //frames used for kstack
   int brk; //brk
   int minBrk; //brk at start (can't go under this)
   UserContext uc;
   KernelContext kc;
-  u_long wakeTime; //wake time (used for delay)
+  ktimer_t delayTimer; //wakes it up from Delay
+  int deathTick; //clock tick it went on the reclaim list
   int abort; //flag if need to abort pcb at last use
   int blocked; //flag to mark pcb as blocked
   int exit; //exit status
-  int lockID; //if waiting on a lock
-  int cvarID; //if waiting on a cvar
-  int pipeID; //if waiting on a pipe
-  int ttyReadWaiting; //if waiting on a tty read
-  int ttyWriteWaiting; //if waiting on a tty write
+  int pinned; //kernel is working with process memory, don't page it out
+  int priority; //mlfq level, 0 is highest
+  int sliceUsed; //clock ticks run at that level (kept across blocking, so short sleeps don't dodge demotion)
 };
 
 typedef struct pcb pcb_t;
@@ -49,12 +185,15 @@ typedef struct pcb pcb_t;
  */
 struct processes {
   pcb_t* running;
-  pcb_t* ready;
-  pcb_t* zombie;
-  pcb_t* blockedDelay;  //waiting on timer
-  pcb_t* blockedIO;  //waiting on IO
-  pcb_t* blockedSync;  //waiting for locks or cvars
-  pcb_t* blockedWait; //waiting for wait
+  pcbQueue_t ready[MLFQ_LEVELS]; //one per mlfq level (round robin only uses level 0)
+  pcbQueue_t blockedDelay;  //waiting on timer
+  pcbQueue_t blockedIO;  //waiting on IO
+  pcbQueue_t blockedSync;  //waiting for locks or cvars
+  pcbQueue_t blockedWait; //waiting for wait
+  pcb_t* table[PROC_TABLE_SIZE]; //every pcb with a pid, hashed by pid
+  int numProcs; //pcbs in the table
+  int policy; //SCHED_RR or SCHED_MLFQ
+  int ticksToBoost; //clock ticks til mlfq moves everyone back to level 0
 }; 
 
 typedef struct processes processes_t;
@@ -73,6 +212,8 @@ typedef void(*fptr)(UserContext*);
 typedef struct tty_buffer {
     char buf[TERMINAL_MAX_LINE];
     int count;  //number of valid bytes in the buffer
+    pcbQueue_t waiters;  //processes waiting their turn to read (or write) the terminal
+    pcb_t* writer;  //process whose transmission is in flight (output buffers only)
 } tty_buffer_t;
 
 /*global array of TTY buffers.*/
@@ -83,12 +224,47 @@ extern tty_buffer_t tty_out_buffers[MAX_TTY];
 
 extern int tty_transmitting[MAX_TTY];
 
+/*
+ * one page of swap traffic, moved a sector at a time as disk
+ *  interrupts come in. requests queue up and the disk works
+ *  through them in order
+ */
+typedef struct diskRequest {
+  int op; //DISK_READ or DISK_WRITE
+  int slot; //swap slot being read or written
+  int buffer; //bounce buffer holding the page
+  int sector; //sectors of the page done so far
+  int done; //set once every sector is done
+  struct pcb* waiter; //process blocked til the request is done (NULL for writes)
+  struct diskRequest* next;
+} diskRequest_t;
+
+/*
+ * cache of one kind of kernel object, carved out of page sized
+ *  slabs. free objects sit on a list threaded through their
+ *  first word, so alloc and free are a pop and a push
+ */
+typedef struct slabCache {
+  char* name;
+  int objSize; //bytes per object slot (the object plus the free list link in front of it)
+  int perSlab; //objects that fit in a slab
+  void (*ctor)(void*); //puts an object in its starting state, once, as its slab is carved
+  void* slabs; //every slab the cache owns (first word links them)
+  void* freeList; //slots of free objects (still constructed)
+  int numSlabs;
+  int inUse; //objects handed out right now
+  int highWater; //most objects handed out at once
+  int allocs;
+  int frees;
+} slabCache_t;
+
 /* sync */
 struct lock {
   int id;
   int owner; // pid of owner
   int held; // 0 if free, 1 if held
   int creator; //pid of process that initialized the lock
+  pcbQueue_t waiters; //processes waiting to acquire, first in line gets it next
 };
 
 typedef struct lock lock_t;
@@ -96,6 +272,7 @@ typedef struct lock lock_t;
 struct cvar {
   int id;
   int creator; // pid of process that created
+  pcbQueue_t waiters; //processes waiting to be signalled
 };
 
 typedef struct cvar cvar_t;
@@ -107,6 +284,8 @@ typedef struct pipe {
   char buf[PIPE_BUFFER_LEN];
   int lock;  //the id for the lock protecting this pipe
   int creator;  //the pid of the process that created this pipe
+  pcbQueue_t readers;  //processes waiting for bytes
+  pcbQueue_t writers;  //processes waiting for room
 } pipe_t;
 
 #endif
@@ -10,17 +10,19 @@
 #include <ykernel.h>
 #include "sys.h"
 #include "stubs.h"
+#include "workset.h"
 
 #define ARG_LEN 64
 #define MAX_ARGS 16
 
 //LOCAL FUNCTIONS
 int isUserReadableString(char* string, pcb_t* curr);
-int isUserWritableString(char* string, pcb_t* curr);
 int isUserAddress(void* addr);
 int isWritableAddress(void* addr, pcb_t* curr);
 int isValidBrk(int page, pcb_t* curr);
 int isReadableAddress(void* addr, pcb_t* curr);
+int isWritableBuffer(void* buf, int len, pcb_t* curr);
+int isReadableBuffer(void* buf, int len, pcb_t* curr);
 
 /*************** stub_fork ***************/
 /*
@@ -157,14 +159,15 @@ stub_wait()
 
   UserContext* uc = &(curr->uc);
 
+  //status is optional
   int* statusAddr = (int*)(uc->regs[0]);
-  if (!isUserAddress((void*)statusAddr)){
+  if (statusAddr != NULL && !isUserAddress((void*)statusAddr)){
     TracePrintf(0, "ERROR: Address passed to wait is outside user land\n");
     uc->regs[0] = ERROR;
     return;
   }
 
-  if (!(isWritableAddress((void*)statusAddr, curr) == 1)){
+  if (statusAddr != NULL && !(isWritableAddress((void*)statusAddr, curr) == 1)){
     TracePrintf(0, "ERROR: Address passed to wait is not writable for user\n");
     uc->regs[0] = ERROR;
     return;
@@ -274,7 +277,7 @@ stub_ttyRead()
   void* buf = (void*)uc->regs[1];
   int len = uc->regs[2];
 
-  if (!isUserWritableString((char*)buf, curr)){
+  if (!isWritableBuffer(buf, len, curr)){
     TracePrintf(0, "ERROR: Address passed to tty read is not writable for user\n");
     uc->regs[0] = ERROR;
     return;
@@ -303,8 +306,8 @@ stub_ttyWrite()
   void* buf = (void*)uc->regs[1];
   int len = uc->regs[2];
 
-  if (!isUserReadableString((char*)buf, curr)){
-    TracePrintf(0, "ERROR: Address passed to tty read is not readable for user\n");
+  if (!isReadableBuffer(buf, len, curr)){
+    TracePrintf(0, "ERROR: Address passed to tty write is not readable for user\n");
     uc->regs[0] = ERROR;
     return;
   }
@@ -329,6 +332,12 @@ stub_lockInit()
   UserContext* uc = &(curr->uc);
   
   int* lockID_p = (int*)uc->regs[0];
+  if (!isWritableBuffer((void*)lockID_p, sizeof(int), curr)){
+    TracePrintf(0, "ERROR: Address passed to lock init is not writable for user\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
   int rc = sys_lockInit(lockID_p);
   uc->regs[0] = rc;
   
@@ -392,6 +401,12 @@ stub_cvarInit()
 
   
   int* cvarID_p = (int*)uc->regs[0];
+  if (!isWritableBuffer((void*)cvarID_p, sizeof(int), curr)){
+    TracePrintf(0, "ERROR: Address passed to cvar init is not writable for user\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
   int rc = sys_cvarInit(cvarID_p);
   uc->regs[0] = rc;
   
@@ -493,6 +508,12 @@ stub_pipeInit()
   UserContext *uc = &(curr->uc);
   
   int *pipe_idp = (int *) uc->regs[0];
+  if (!isWritableBuffer((void*)pipe_idp, sizeof(int), curr)){
+    TracePrintf(0, "ERROR: Address passed to pipe init is not writable for user\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
   int rc = sys_pipeInit(pipe_idp);
   
   //return the status in register 0.
@@ -515,6 +536,12 @@ stub_pipeRead()
   int pipe_id = uc->regs[0];
   void *buf = (void *) uc->regs[1];
   int len = uc->regs[2];
+
+  if (!isWritableBuffer(buf, len, curr)){
+    TracePrintf(0, "ERROR: Address passed to pipe read is not writable for user\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
   
   int rc = sys_pipeRead(pipe_id, buf, len);
   
@@ -537,6 +564,12 @@ stub_pipeWrite()
   int pipe_id = uc->regs[0];
   void *buf = (void *) uc->regs[1];
   int len = uc->regs[2];
+
+  if (!isReadableBuffer(buf, len, curr)){
+    TracePrintf(0, "ERROR: Address passed to pipe write is not readable for user\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
   
   int rc = sys_pipeWrite(pipe_id, buf, len);
   
@@ -544,6 +577,124 @@ stub_pipeWrite()
   TracePrintf(5, "EXIT stub_pipeWrite\n");
 }
 
+/*************** stub_sharedPages ***************/
+/*
+ * see stubs.h
+ */
+void
+stub_sharedPages()
+{
+  TracePrintf(5, "ENTER stub_sharedPages\n");
+  pcb_t* curr = coord_getRunningProcess();
+
+  UserContext* uc = &(curr->uc);
+
+  int numPages = uc->regs[0];
+  if (numPages <= 0){
+    TracePrintf(0, "ERROR: Shared_Pages needs at least one page\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
+  uc->regs[0] = sys_sharedPages(SHM_ANON, numPages);
+
+  TracePrintf(5, "EXIT stub_sharedPages\n");
+}
+
+/*************** stub_sharedAttach ***************/
+/*
+ * see stubs.h
+ */
+void
+stub_sharedAttach()
+{
+  TracePrintf(5, "ENTER stub_sharedAttach\n");
+  pcb_t* curr = coord_getRunningProcess();
+
+  UserContext* uc = &(curr->uc);
+
+  int key = uc->regs[0];
+  int numPages = uc->regs[1];
+  if (key == SHM_ANON || numPages < 0){
+    TracePrintf(0, "ERROR: bad key or size passed to shared attach\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
+  uc->regs[0] = sys_sharedPages(key, numPages);
+
+  TracePrintf(5, "EXIT stub_sharedAttach\n");
+}
+
+/*************** stub_memStats ***************/
+/*
+ * see stubs.h
+ */
+void
+stub_memStats()
+{
+  TracePrintf(5, "ENTER stub_memStats\n");
+  pcb_t* curr = coord_getRunningProcess();
+
+  UserContext* uc = &(curr->uc);
+
+  int* buf = (int*) uc->regs[0];
+  int count = uc->regs[1];
+  if (count < 0){
+    TracePrintf(0, "ERROR: negative count passed to memory stats\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
+  //only the stats we have get written, so only check that much of buf
+  if (count > MEMSTAT_COUNT){
+    count = MEMSTAT_COUNT;
+  }
+  if (!isWritableBuffer(buf, count * sizeof(int), curr)){
+    TracePrintf(0, "ERROR: Address passed to memory stats is not writable for user\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
+  uc->regs[0] = sys_memStats(buf, count);
+
+  TracePrintf(5, "EXIT stub_memStats\n");
+}
+
+/*************** stub_clockStats ***************/
+/*
+ * see stubs.h
+ */
+void
+stub_clockStats()
+{
+  TracePrintf(5, "ENTER stub_clockStats\n");
+  pcb_t* curr = coord_getRunningProcess();
+
+  UserContext* uc = &(curr->uc);
+
+  int* buf = (int*) uc->regs[0];
+  int count = uc->regs[1];
+  if (count < 0){
+    TracePrintf(0, "ERROR: negative count passed to clock stats\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
+  if (count > CLOCKSTAT_COUNT){
+    count = CLOCKSTAT_COUNT;
+  }
+  if (!isWritableBuffer(buf, count * sizeof(int), curr)){
+    TracePrintf(0, "ERROR: Address passed to clock stats is not writable for user\n");
+    uc->regs[0] = ERROR;
+    return;
+  }
+
+  uc->regs[0] = sys_clockStats(buf, count);
+
+  TracePrintf(5, "EXIT stub_clockStats\n");
+}
+
 //--------------------------------------------------------
 /*************** local check functions  *****************/
 //--------------------------------------------------------
@@ -574,32 +725,6 @@ isUserReadableString(char* string, pcb_t* curr)
   }
   return 1;
 }
-/*************** isUserWritableString ***************/
-/*
- * Determines whether an entire user land string is
- * a writable string in user land
- *
- * input:
- *    string - the string to be checked.
- *
- * output:
- *  return 0 if not valid
- *  return 1 if valid
- * 
- */
-int
-isUserWritableString(char* string, pcb_t* curr)
-{
-  for (int i = 0; string[i] != '\0'; i++){
-    if (!isUserAddress((void*)(&string[i]))){
-      return 0;
-    }
-    if (!isWritableAddress((void*)(&string[i]), curr)){
-      return 0;
-    }
-  }
-  return 1;
-}
 /*************** isUserAddress ***************/
 /*
  * Determines whether the given address lies within the user address space.
@@ -643,8 +768,8 @@ isUserAddress(void* addr)
 int
 isValidBrk(int page, pcb_t* curr)
 {
-  int stackBrk = mem_getStackBrk(curr->pt);
-  if (page >= curr->minBrk && page <= stackBrk - 1){
+  int stackBrk = mem_getStackBrk(curr);
+  if (page >= curr->minBrk && page <= stackBrk - 1 && !shm_overlaps(curr, curr->brk, page)){
     return 1;
   }
 
@@ -676,13 +801,62 @@ isWritableAddress(void* addr, pcb_t* curr)
     return 0;
   }
 
-  if (pt[page].valid == 0 || (pt[page].prot & PROT_WRITE) == 0){
+  //text or data page not read in yet (or paged out), bring it in now
+  if (pt[page].valid == 0 && (curr->pageFlags[page] & PAGE_FILE)){
+    LoadPage(curr, page);
+  }
+  if (pt[page].valid == 0 && (curr->pageFlags[page] & PAGE_SWAP)){
+    swap_in(curr, page);
+  }
+
+  if (pt[page].valid == 0){
+    return 0;
+  }
+
+  //the working set sampler might have taken the page's protection for a moment
+  ws_fault(curr, page);
+
+  //read only page might just be copy on write, resolve it now so kernel can write to it
+  if ((pt[page].prot & PROT_WRITE) == 0 && mem_handleWriteFault(curr, page) != 1){
     return 0;
   }
 
   return 1;
 }
 
+/*************** isWritableBuffer ***************/
+/*
+ * Checks if every page of a user buffer is writable by the process
+ *
+ * input:
+ *    buf - start of the buffer.
+ *    len - length of the buffer in bytes.
+ *    curr - pointer to the process's PCB.
+ *
+ * output:
+ *    returns non-zero if the whole buffer is writable,
+ *    returns 0 if any of it is not writable.
+ * 
+ */
+int
+isWritableBuffer(void* buf, int len, pcb_t* curr)
+{
+  if (len <= 0){
+    return isUserAddress(buf) && isWritableAddress(buf, curr);
+  }
+
+  //check one address in each page the buffer touches
+  u_long start = DOWN_TO_PAGE(buf);
+  u_long end = (u_long)buf + len;
+  for (u_long addr = start; addr < end; addr += PAGESIZE){
+    if (!isUserAddress((void*)addr) || !isWritableAddress((void*)addr, curr)){
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
 /*************** isReadableAddress ***************/
 /*
  * Checks if the given address is readable by the process specified by curr.
@@ -706,9 +880,57 @@ isReadableAddress(void* addr, pcb_t* curr)
     return 0;
   }
 
-  if (pt[page].valid == 0 || (pt[page].prot & PROT_READ) == 0){
+  //text or data page not read in yet (or paged out), bring it in now
+  if (pt[page].valid == 0 && (curr->pageFlags[page] & PAGE_FILE)){
+    LoadPage(curr, page);
+  }
+  if (pt[page].valid == 0 && (curr->pageFlags[page] & PAGE_SWAP)){
+    swap_in(curr, page);
+  }
+
+  if (pt[page].valid == 0){
+    return 0;
+  }
+
+  //the working set sampler might have taken the page's protection for a moment
+  ws_fault(curr, page);
+
+  if ((pt[page].prot & PROT_READ) == 0){
     return 0;
   }
 
   return 1;
 }
+
+/*************** isReadableBuffer ***************/
+/*
+ * Checks if every page of a user buffer is readable by the process
+ *
+ * input:
+ *    buf - start of the buffer.
+ *    len - length of the buffer in bytes.
+ *    curr - pointer to the process's PCB.
+ *
+ * output:
+ *    returns non-zero if the whole buffer is readable,
+ *    returns 0 if any of it is not readable.
+ * 
+ */
+int
+isReadableBuffer(void* buf, int len, pcb_t* curr)
+{
+  if (len <= 0){
+    return isUserAddress(buf) && isReadableAddress(buf, curr);
+  }
+
+  //check one address in each page the buffer touches
+  u_long start = DOWN_TO_PAGE(buf);
+  u_long end = (u_long)buf + len;
+  for (u_long addr = start; addr < end; addr += PAGESIZE){
+    if (!isUserAddress((void*)addr) || !isReadableAddress((void*)addr, curr)){
+      return 0;
+    }
+  }
+
+  return 1;
+}
@@ -427,6 +427,94 @@ void stub_pipeWrite();
 
 //---------------------------------------------
 
+/*************** stub_sharedPages ***************/
+/*
+ * Maps a new unnamed shared memory segment (Shared_Pages).
+ *
+ * input:
+ *   The number of pages is provided in the user context.
+ *
+ * output:
+ *   Returns the address of the segment, or ERROR on failure.
+ *
+ * Side Effects:
+ *   Allocates frames and maps them into the process (and any
+ *   children it forks later).
+ * 
+ */
+
+//---------------------------------------------
+
+void stub_sharedPages();
+
+//---------------------------------------------
+
+/*************** stub_sharedAttach ***************/
+/*
+ * Maps a named shared memory segment, making it if it doesn't
+ *  exist (Custom0(key, numPages, 0, 0)).
+ *
+ * input:
+ *   The key and number of pages are provided in the user context.
+ *
+ * output:
+ *   Returns the address of the segment, or ERROR on failure.
+ *
+ * Side Effects:
+ *   Allocates frames for a new segment and maps them into the process.
+ * 
+ */
+
+//---------------------------------------------
+
+void stub_sharedAttach();
+
+//---------------------------------------------
+
+/*************** stub_memStats ***************/
+/*
+ * Reports physical memory usage (Custom1(buf, count, 0, 0)).
+ *
+ * input:
+ *   The stats buffer and how many ints it holds are provided in
+ *   the user context.
+ *
+ * output:
+ *   Returns the number of stats written, or ERROR on failure.
+ *
+ * Side Effects:
+ *   None.
+ * 
+ */
+
+//---------------------------------------------
+
+void stub_memStats();
+
+//---------------------------------------------
+
+/*************** stub_clockStats ***************/
+/*
+ * Reports the clock tick, timer and scheduler counts (Custom2(buf, count, 0, 0)).
+ *
+ * input:
+ *   The stats buffer and how many ints it holds are provided in
+ *   the user context.
+ *
+ * output:
+ *   Returns the number of stats written, or ERROR on failure.
+ *
+ * Side Effects:
+ *   None.
+ * 
+ */
+
+//---------------------------------------------
+
+void stub_clockStats();
+
+//---------------------------------------------
+
 #endif
 
 
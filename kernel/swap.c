@@ -0,0 +1,624 @@
+/*
+ * file: swap.c
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  pages user memory out to the disk when frames run out,
+ *  and back in when the page is touched again
+ */
+
+#include <ykernel.h>
+#include "swap.h"
+#include "memory.h"
+#include "codes.h"
+#include "structs.h"
+#include "coordination.h"
+#include "zcache.h"
+#include "workset.h"
+
+/***************** globals *****************/
+extern processes_t* processes;
+extern int currentClockTick;
+
+char swapBuffers[SWAP_BUFFERS][PAGESIZE]; //region 0 copies of pages going to or from disk
+diskRequest_t requests[SWAP_BUFFERS]; //one request per buffer
+int bufferBusy[SWAP_BUFFERS];
+pcbQueue_t bufferWaiters; //processes waiting for a buffer to free up
+int slotRefs[SWAP_SLOTS]; //number of ptes pointing at each slot
+int slotPending[SWAP_SLOTS]; //buffer still being written out to slot (ERROR if none)
+diskRequest_t* diskHead; //request the disk is working on
+diskRequest_t* diskTail;
+int clockPid; //clock hand, resumes at this process and page
+int clockPage;
+int swapReady;
+int swapOuts; //pages written out
+int swapIns; //pages read back in
+int swapBufferHits; //pages taken back before their write finished
+int compressOuts; //pages put in the compressed store instead of on disk
+int compressIns; //pages brought back from the compressed store
+long diskInTicks; //ticks spent waiting on the disk to read pages back in
+
+/******************* local funcs *******************/
+int canBlock();
+int getBuffer();
+void releaseBuffer(int buffer);
+int getSlot();
+int findVictim(pcb_t** victim, int* victimPage);
+int isEvictable(pcb_t* pcb, int page);
+void queueDisk(int op, int slot, int buffer, pcb_t* waiter);
+void startDisk();
+
+/***************** swap_init *****************/
+/*
+ * see swap.h for description
+ */
+void
+swap_init()
+{
+  TracePrintf(5, "ENTER swap_init\n");
+
+  for (int slot = 0; slot < SWAP_SLOTS; slot++){
+    slotRefs[slot] = 0;
+    slotPending[slot] = ERROR;
+  }
+  for (int buffer = 0; buffer < SWAP_BUFFERS; buffer++){
+    bufferBusy[buffer] = 0;
+  }
+
+  diskHead = NULL;
+  diskTail = NULL;
+  clockPid = 0;
+  clockPage = 0;
+  swapReady = 1;
+
+  TracePrintf(1, "swap: %d slots of %d sectors\n", SWAP_SLOTS, SECTORS_PER_PAGE);
+  TracePrintf(5, "EXIT swap_init\n");
+}
+
+/***************** swap_exit *****************/
+/*
+ * see swap.h for description
+ */
+void
+swap_exit()
+{
+  TracePrintf(1, "swap: %d pages out, %d pages in (%d from buffers), %d slots free\n",
+      swapOuts, swapIns, swapBufferHits, swap_getFreeSlotCount());
+
+  //compressed pages come back within the fault, disk reads block for however long
+  int diskReads = swapIns - swapBufferHits;
+  int restores = compressIns + swapIns;
+  TracePrintf(1, "swap: %d pages compressed, %d restored from memory (%d%% of restores), disk reads avg %d ticks\n",
+      compressOuts, compressIns, restores ? compressIns * 100 / restores : 0,
+      diskReads ? (int)(diskInTicks / diskReads) : 0);
+}
+
+/***************** swap_compress *****************/
+/*
+ * see swap.h for description
+ */
+int
+swap_compress()
+{
+  TracePrintf(5, "ENTER swap_compress\n");
+
+  if (!swapReady || !zcache_hasRoom()){
+    return ERROR;
+  }
+
+  pcb_t* victim;
+  int page;
+  if (findVictim(&victim, &page) == ERROR){
+    TracePrintf(1, "swap_compress: no page can be paged out\n");
+    return ERROR;
+  }
+
+  //pages that don't compress stay put, the disk can have them
+  pte_t* pt = victim->pt;
+  int frame = pt[page].pfn;
+  int entry = zcache_store(frame);
+  if (entry == ERROR){
+    TracePrintf(5, "EXIT swap_compress (page %d of process %d stays)\n", page, victim->pid);
+    return ERROR;
+  }
+
+  pt[page].valid = 0;
+  pt[page].pfn = entry;
+  victim->pageFlags[page] |= (PAGE_SWAP | PAGE_ZCACHE);
+  victim->pageFlags[page] &= ~PAGE_REF;
+  WriteRegister(REG_TLB_FLUSH, (page << PAGESHIFT) + VMEM_1_BASE);
+  compressOuts++;
+
+  TracePrintf(3, "swap_compress: page %d of process %d to entry %d, frame %d freed\n", page, victim->pid, entry, frame);
+  TracePrintf(5, "EXIT swap_compress\n");
+  return frame;
+}
+
+/***************** swap_evict *****************/
+/*
+ * see swap.h for description
+ */
+int
+swap_evict()
+{
+  TracePrintf(5, "ENTER swap_evict\n");
+
+  if (!swapReady){
+    return ERROR;
+  }
+
+  //getting a buffer may block, so pick slot and victim after
+  int buffer = getBuffer();
+  if (buffer == ERROR){
+    TracePrintf(1, "swap_evict: no buffer to page out through\n");
+    return ERROR;
+  }
+
+  int slot = getSlot();
+  if (slot == ERROR){
+    TracePrintf(1, "swap_evict: swap is full\n");
+    releaseBuffer(buffer);
+    return ERROR;
+  }
+
+  pcb_t* victim;
+  int page;
+  if (findVictim(&victim, &page) == ERROR){
+    TracePrintf(1, "swap_evict: no page can be paged out\n");
+    releaseBuffer(buffer);
+    return ERROR;
+  }
+
+  //copy the page out and point the pte at its slot instead
+  pte_t* pt = victim->pt;
+  int frame = pt[page].pfn;
+  mem_readFrame(frame, swapBuffers[buffer]);
+
+  pt[page].valid = 0;
+  pt[page].pfn = slot;
+  victim->pageFlags[page] |= PAGE_SWAP;
+  victim->pageFlags[page] &= ~PAGE_REF;
+  WriteRegister(REG_TLB_FLUSH, (page << PAGESHIFT) + VMEM_1_BASE);
+
+  //buffer holds the page til the write is done, so the frame is free now
+  slotRefs[slot] = 1;
+  slotPending[slot] = buffer;
+  queueDisk(DISK_WRITE, slot, buffer, NULL);
+  swapOuts++;
+
+  TracePrintf(3, "swap_evict: page %d of process %d to slot %d, frame %d freed\n", page, victim->pid, slot, frame);
+  TracePrintf(5, "EXIT swap_evict\n");
+  return frame;
+}
+
+/***************** swap_in *****************/
+/*
+ * see swap.h for description
+ */
+int
+swap_in(pcb_t* pcb, int page)
+{
+  TracePrintf(5, "ENTER swap_in (page %d)\n", page);
+
+  pte_t* pt = pcb->pt;
+  if (page < 0 || page >= MAX_PT_LEN || pt[page].valid || (pcb->pageFlags[page] & PAGE_SWAP) == 0){
+    TracePrintf(3, "swap_in: page %d not swapped\n", page);
+    return ERROR;
+  }
+
+  int slot = pt[page].pfn;
+
+  //get the frame first, making room may page something else out
+  int frame = mem_allocFrame();
+  if (frame == ERROR){
+    TracePrintf(1, "swap_in: no frame for page %d\n", page);
+    return ERROR;
+  }
+
+  if (pcb->pageFlags[page] & PAGE_ZCACHE){
+    //kept compressed in memory, no disk involved
+    if (zcache_load(slot, frame) == ERROR){
+      mem_freeFrame(frame);
+      return ERROR;
+    }
+    zcache_drop(slot);
+    compressIns++;
+
+    pt[page].pfn = frame;
+    pt[page].valid = 1;
+    pcb->pageFlags[page] &= ~(PAGE_SWAP | PAGE_ZCACHE);
+    pcb->pageFlags[page] |= PAGE_REF;
+    pcb->pageAge[page] = 0;
+    WriteRegister(REG_TLB_FLUSH, (page << PAGESHIFT) + VMEM_1_BASE);
+
+    TracePrintf(5, "EXIT swap_in (from compressed store)\n");
+    return 0;
+  }
+
+  if (slotPending[slot] != ERROR){
+    //still on its way out, take it straight from the buffer
+    mem_writeFrame(frame, swapBuffers[slotPending[slot]]);
+    swapBufferHits++;
+  } else {
+    int buffer = getBuffer();
+    if (buffer == ERROR){
+      TracePrintf(1, "swap_in: no buffer to page in through\n");
+      mem_freeFrame(frame);
+      return ERROR;
+    }
+
+    //wait for the disk to read the page in
+    int start = currentClockTick;
+    queueDisk(DISK_READ, slot, buffer, pcb);
+    while (!requests[buffer].done){
+      coord_addProcess(pcb, BLOCKEDIO);
+      coord_scheduleProcess();
+    }
+    diskInTicks += currentClockTick - start;
+
+    mem_writeFrame(frame, swapBuffers[buffer]);
+    releaseBuffer(buffer);
+  }
+
+  //protections stayed in the pte while it was swapped
+  pt[page].pfn = frame;
+  pt[page].valid = 1;
+  pcb->pageFlags[page] &= ~PAGE_SWAP;
+  pcb->pageFlags[page] |= PAGE_REF;
+  pcb->pageAge[page] = 0;
+  WriteRegister(REG_TLB_FLUSH, (page << PAGESHIFT) + VMEM_1_BASE);
+
+  slotRefs[slot]--;
+  swapIns++;
+
+  TracePrintf(5, "EXIT swap_in\n");
+  return 0;
+}
+
+/***************** swap_sharePage *****************/
+/*
+ * see swap.h for description
+ */
+void
+swap_sharePage(pcb_t* pcb, int page)
+{
+  if (pcb->pageFlags[page] & PAGE_ZCACHE){
+    zcache_share(pcb->pt[page].pfn);
+  } else {
+    slotRefs[pcb->pt[page].pfn]++;
+  }
+}
+
+/***************** swap_dropPage *****************/
+/*
+ * see swap.h for description
+ */
+void
+swap_dropPage(pcb_t* pcb, int page)
+{
+  if ((pcb->pageFlags[page] & PAGE_SWAP) == 0){
+    return;
+  }
+
+  //slot stays taken til any write to it finishes (see getSlot)
+  if (pcb->pageFlags[page] & PAGE_ZCACHE){
+    zcache_drop(pcb->pt[page].pfn);
+  } else {
+    slotRefs[pcb->pt[page].pfn]--;
+  }
+  pcb->pt[page].pfn = 0;
+  pcb->pt[page].prot = PROT_NONE;
+  pcb->pageFlags[page] &= ~(PAGE_SWAP | PAGE_ZCACHE);
+}
+
+/***************** swap_getFreeSlotCount *****************/
+/*
+ * see swap.h for description
+ */
+int
+swap_getFreeSlotCount()
+{
+  int count = 0;
+  for (int slot = 0; slot < SWAP_SLOTS; slot++){
+    if (slotRefs[slot] == 0 && slotPending[slot] == ERROR){
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/***************** swap_diskInterrupt *****************/
+/*
+ * see swap.h for description
+ */
+void
+swap_diskInterrupt()
+{
+  diskRequest_t* req = diskHead;
+  if (req == NULL){
+    TracePrintf(1, "swap_diskInterrupt: disk interrupt with nothing queued\n");
+    return;
+  }
+
+  //more sectors to go on this page
+  req->sector++;
+  if (req->sector < SECTORS_PER_PAGE){
+    startDisk();
+    return;
+  }
+
+  //page done, take it off the queue
+  diskHead = req->next;
+  if (diskHead == NULL){
+    diskTail = NULL;
+  }
+
+  if (req->op == DISK_WRITE){
+    //slot on disk is good now, buffer can go
+    TracePrintf(3, "swap_diskInterrupt: slot %d written\n", req->slot);
+    slotPending[req->slot] = ERROR;
+    releaseBuffer(req->buffer);
+  } else {
+    //let the reader pick up its page
+    TracePrintf(3, "swap_diskInterrupt: slot %d read for process %d\n", req->slot, req->waiter->pid);
+    req->done = 1;
+    coord_removeProcess(req->waiter, BLOCKEDIO);
+    coord_addProcess(req->waiter, READY);
+  }
+
+  startDisk();
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** canBlock ********************/
+/*
+ * whether the code running right now can block
+ *
+ * output:
+ *  return 1 if a real process is running
+ *  return 0 if booting or idle is running
+ *
+ */
+int
+canBlock()
+{
+  if (processes == NULL || processes->running == NULL){
+    return 0;
+  }
+
+  return processes->running != coord_getIdlePCB();
+}
+
+/******************** getBuffer ********************/
+/*
+ * take a free bounce buffer, blocking til one frees up
+ *  if they're all headed to disk
+ *
+ * output:
+ *  return buffer index
+ *  return ERROR if none free and can't block
+ *
+ */
+int
+getBuffer()
+{
+  while (1){
+    for (int buffer = 0; buffer < SWAP_BUFFERS; buffer++){
+      if (!bufferBusy[buffer]){
+        bufferBusy[buffer] = 1;
+        return buffer;
+      }
+    }
+
+    if (!canBlock()){
+      return ERROR;
+    }
+
+    //woken by releaseBuffer
+    coord_blockOn(processes->running, &bufferWaiters, BLOCKEDIO);
+    coord_scheduleProcess();
+  }
+}
+
+/******************** releaseBuffer ********************/
+/*
+ * give back a bounce buffer and wake someone waiting on one
+ *
+ * input:
+ *  buffer - buffer index
+ *
+ */
+void
+releaseBuffer(int buffer)
+{
+  bufferBusy[buffer] = 0;
+
+  coord_wakeOne(&bufferWaiters);
+}
+
+/******************** getSlot ********************/
+/*
+ * find a free swap slot. a slot with a write still in
+ *  flight isn't free, even if no pte points at it, so
+ *  two writes to one slot never race
+ *
+ * output:
+ *  return slot
+ *  return ERROR if swap is full
+ *
+ */
+int
+getSlot()
+{
+  for (int slot = 0; slot < SWAP_SLOTS; slot++){
+    if (slotRefs[slot] == 0 && slotPending[slot] == ERROR){
+      return slot;
+    }
+  }
+
+  return ERROR;
+}
+
+/******************** findVictim ********************/
+/*
+ * run the clock hand over every process's pages (in pid
+ *  order) til it finds a page to page out. recently
+ *  brought in pages get a second chance
+ *
+ * input:
+ *  victim - filled with process owning the page
+ *  victimPage - filled with the page
+ *
+ * output:
+ *  return 0 if found
+ *  return ERROR if nothing can be paged out
+ *
+ */
+int
+findVictim(pcb_t** victim, int* victimPage)
+{
+  //gather everyone who could hold pages, in pid order so the hand sweeps the same way every time
+  pcb_t* procs[MAX_PROCS];
+  int numProcs = coord_listProcesses(procs, MAX_PROCS);
+
+  //(idle can't block for a page in, pinned memory is in use by the kernel,
+  //except while it sleeps in Delay or Wait, which page their buffers back in)
+  int kept = 0;
+  for (int i = 0; i < numProcs; i++){
+    pcb_t* pcb = procs[i];
+    int sleeping = coord_containsProcess(pcb, BLOCKEDDELAY) == 1 || coord_containsProcess(pcb, BLOCKEDWAIT) == 1;
+    if ((!pcb->pinned || sleeping) && pcb->pt != NULL){
+      procs[kept++] = procs[i];
+    }
+  }
+  numProcs = kept;
+
+  if (numProcs == 0){
+    return ERROR;
+  }
+
+  //pick up where the hand left off
+  int start = 0;
+  while (start < numProcs && procs[start]->pid < clockPid){
+    start++;
+  }
+  int startPos = 0;
+  if (start < numProcs){
+    startPos = start * MAX_PT_LEN;
+    if (procs[start]->pid == clockPid){
+      startPos += clockPage;
+    }
+  }
+
+  //two trips around, first one may only clear reference bits (with the
+  //working set sampler on, one more trip first that only takes cold pages)
+  int positions = numProcs * MAX_PT_LEN;
+  int laps = (WS_SAMPLE_INTERVAL > 0) ? 3 : 2;
+  for (int i = 0; i < laps * positions; i++){
+    int pos = (startPos + i) % positions;
+    pcb_t* pcb = procs[pos / MAX_PT_LEN];
+    int page = pos % MAX_PT_LEN;
+
+    if (!isEvictable(pcb, page)){
+      continue;
+    }
+
+    if (laps == 3 && i < positions && pcb->pageAge[page] < WS_COLD_AGE){
+      continue;
+    }
+
+    if (pcb->pageFlags[page] & PAGE_REF){
+      pcb->pageFlags[page] &= ~PAGE_REF;
+      continue;
+    }
+
+    clockPid = pcb->pid;
+    clockPage = page + 1;
+    *victim = pcb;
+    *victimPage = page;
+    return 0;
+  }
+
+  return ERROR;
+}
+
+/******************** isEvictable ********************/
+/*
+ * whether a page can be paged out. only private data,
+ *  heap and stack pages go, anything sharing a frame
+ *  (cow, zero page, text) stays put
+ *
+ * input:
+ *  pcb - process owning the page
+ *  page - region 1 page
+ *
+ * output:
+ *  return 1 if page can be paged out
+ *  return 0 if not
+ *
+ */
+int
+isEvictable(pcb_t* pcb, int page)
+{
+  pte_t* pt = pcb->pt;
+  if (pt[page].valid == 0 || (ws_getProt(pcb, page) & PROT_EXEC)){
+    return 0;
+  }
+
+  return mem_getFrameRefs(pt[page].pfn) == 1;
+}
+
+/******************** queueDisk ********************/
+/*
+ * queue a page of disk work, starting the disk if it's idle
+ *
+ * input:
+ *  op - DISK_READ or DISK_WRITE
+ *  slot - swap slot
+ *  buffer - bounce buffer holding (or getting) the page
+ *  waiter - process to wake when done (NULL for none)
+ *
+ */
+void
+queueDisk(int op, int slot, int buffer, pcb_t* waiter)
+{
+  diskRequest_t* req = &requests[buffer];
+  req->op = op;
+  req->slot = slot;
+  req->buffer = buffer;
+  req->sector = 0;
+  req->done = 0;
+  req->waiter = waiter;
+  req->next = NULL;
+
+  if (diskTail == NULL){
+    diskHead = req;
+    diskTail = req;
+    startDisk();
+  } else {
+    diskTail->next = req;
+    diskTail = req;
+  }
+}
+
+/******************** startDisk ********************/
+/*
+ * start the next sector of the request at the head of
+ *  the queue (if any)
+ *
+ */
+void
+startDisk()
+{
+  diskRequest_t* req = diskHead;
+  if (req == NULL){
+    return;
+  }
+
+  int sector = req->slot * SECTORS_PER_PAGE + req->sector;
+  DiskAccess(req->op, sector, swapBuffers[req->buffer] + req->sector * SECTORSIZE);
+}
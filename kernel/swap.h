@@ -0,0 +1,203 @@
+/*
+ * file: swap.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  interface for swap.c (paging user memory out to the disk)
+ */
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include <ykernel.h>
+#include "codes.h"
+#include "structs.h"
+
+/********************* swap_init *********************/
+/*
+ * set up the swap area on the disk (every slot free)
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void swap_init();
+
+//-------------------------------------------------------
+
+/********************* swap_exit *********************/
+/*
+ * report swap stats on the way down
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void swap_exit();
+
+//-------------------------------------------------------
+
+/********************* swap_evict *********************/
+/*
+ * page out a victim user page (picked by clock hand) to
+ *  free up its frame
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  return frame taken from the victim (in use, caller owns it)
+ *  return ERROR if nothing can be paged out
+ *
+ * notes:
+ *  the write to disk finishes in the background, but if
+ *  every bounce buffer is busy the running process blocks
+ *  til one frees up. idle and pinned processes are never
+ *  picked as victims, unless they're asleep in Delay or Wait
+ *
+ */
+
+//-------------------------------------------------------
+
+int swap_evict();
+
+//-------------------------------------------------------
+
+/********************* swap_compress *********************/
+/*
+ * page out a victim user page (picked by clock hand) into
+ *  the compressed store instead of the disk
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  return frame taken from the victim (in use, caller owns it)
+ *  return ERROR if the store is full, nothing can be paged
+ *   out or the victim didn't compress (it stays, and the hand
+ *   moves past it)
+ *
+ * notes:
+ *  never blocks. swap_in brings the page back like any other
+ *
+ */
+
+//-------------------------------------------------------
+
+int swap_compress();
+
+//-------------------------------------------------------
+
+/********************* swap_in *********************/
+/*
+ * bring a paged out page back into memory
+ *
+ * input: 
+ *  pcb - process the page belongs to (must be running process)
+ *  page - region 1 page to bring in
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if page isn't swapped or no frame available
+ *
+ * notes:
+ *  blocks the process while the disk reads the page
+ *
+ */
+
+//-------------------------------------------------------
+
+int swap_in(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/********************* swap_sharePage *********************/
+/*
+ * another pte now points at a paged out page's slot (or
+ *  compressed store entry), after fork copied it
+ *
+ * input: 
+ *  pcb - process the page was copied from
+ *  page - region 1 page
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void swap_sharePage(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/********************* swap_dropPage *********************/
+/*
+ * let go of a paged out page without reading it back in
+ *  (does nothing if page isn't swapped)
+ *
+ * input: 
+ *  pcb - process the page belongs to
+ *  page - region 1 page being thrown away
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void swap_dropPage(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/********************* swap_getFreeSlotCount *********************/
+/*
+ * how many more pages could be paged out
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  number of free swap slots
+ *
+ */
+
+//-------------------------------------------------------
+
+int swap_getFreeSlotCount();
+
+//-------------------------------------------------------
+
+/********************* swap_diskInterrupt *********************/
+/*
+ * a disk sector finished, move the current request along
+ *  and start the next sector (called from TRAP_DISK)
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void swap_diskInterrupt();
+
+//-------------------------------------------------------
+
+#endif
@@ -11,6 +11,7 @@
 #include "codes.h"
 #include "structs.h"
 #include "coordination.h"
+#include "slab.h"
 
 /***************** globals *****************/
 lock_t** locks;
@@ -55,7 +56,7 @@ sync_free()
   //free each lock
   for (int i = 0; i < MAX_LOCKS; i++){
     if (locks[i] != NULL){
-      free(locks[i]);
+      slab_free(&lockCache, locks[i]);
       locks[i] = NULL;
     }
   }
@@ -63,7 +64,7 @@ sync_free()
   //free each cvar
   for (int i = 0; i < MAX_CVARS; i++){
     if (cvars[i] != NULL){
-      free(cvars[i]);
+      slab_free(&cvarCache, cvars[i]);
       cvars[i] = NULL;
     }
   }
@@ -92,14 +93,15 @@ sync_initLock()
     if (locks[i] == NULL){
       TracePrintf(3, "Creating lock %d\n", i);
 
-      locks[i] = malloc(sizeof(lock_t));
+      locks[i] = slab_alloc(&lockCache);
       if (locks[i] == NULL){
         TracePrintf(0, "malloc for lock failed\n");
         return ERROR;
       }
 
-      //set lock attributes
+      //set lock attributes (no one waiting on a recycled lock)
       locks[i]->held = 0;
+      locks[i]->owner = -1;
       locks[i]->id = i;
       locks[i]->creator = curr->pid;
 
@@ -185,26 +187,32 @@ sync_lockRelease(int id, int pid)
   lock->held = 0;
   lock->owner = -1;
 
-  //signal people waiting for lock and add them to ready queue
-  pcb_t* waiter = coord_findSyncWaiter(id, LOCK);
-  while (waiter != NULL){
-    if (waiter->pid >= 0){
-      if (coord_removeProcess(waiter->pid, BLOCKEDSYNC) != 1){
-        TracePrintf(3, "Couldn't remove process from blockedSync\n");
-        return ERROR;
-      }
-      if (coord_addProcess(waiter, READY) == ERROR){
-        TracePrintf(3, "Couldn't add process to ready\n");
-        return ERROR;
-      }
-    }
-    waiter = coord_findSyncWaiter(id, LOCK);
-  }
+  //only one of them can get it, wake the one that's waited longest
+  //(if someone beats it to the lock it just waits again)
+  coord_wakeOne(&(lock->waiters));
 
   TracePrintf(5, "EXIT sync_lockRelease\n");
   return 0;
 }
 
+/***************** sync_getWaiters *****************/
+/*
+ * see sync.h for description
+ */
+pcbQueue_t*
+sync_getWaiters(int id)
+{
+  if (id >= 0 && id < MAX_LOCKS && locks[id] != NULL){
+    return &(locks[id]->waiters);
+  }
+
+  if (id >= MAX_LOCKS && id < MAX_LOCKS + MAX_CVARS && cvars[id - MAX_LOCKS] != NULL){
+    return &(cvars[id - MAX_LOCKS]->waiters);
+  }
+
+  return NULL;
+}
+
 /***************** sync_initCvar *****************/
 /*
  * see sync.h for description
@@ -221,7 +229,7 @@ sync_initCvar()
     if (cvars[i] == NULL){
 
       //initialize cvar with attributes
-      cvars[i] = malloc(sizeof(cvar_t));
+      cvars[i] = slab_alloc(&cvarCache);
       if (cvars[i] == NULL){
         TracePrintf(0, "Failed to malloc space for cvar\n");
         return ERROR;
@@ -263,18 +271,8 @@ sync_cvarSignal(int id)
     return ERROR;
   }
 
-  //find first cvar waiter and add them to ready
-  pcb_t* waiter = coord_findSyncWaiter(id, CVAR);
-  if (waiter != NULL){
-    if (coord_removeProcess(waiter->pid, BLOCKEDSYNC) != 1){
-      TracePrintf(0, "Couldn't remove process from blockedSync\n");
-      return ERROR;
-    }
-    if (coord_addProcess(waiter, READY) == ERROR){
-      TracePrintf(0, "Couldn't add process to ready\n");
-      return ERROR;
-    }
-  } else {
+  //wake first cvar waiter
+  if (coord_wakeOne(&(cvar->waiters)) == NULL){
     TracePrintf(8, "No waiter found\n");
 
     //return code 0 implies no one woke (is important for our broadcast implementation)
@@ -295,21 +293,14 @@ sync_cvarBroadcast(int id)
 {
   TracePrintf(5, "ENTER sync_cvarBroadcast\n");
 
-  //check that signal doesn't return error
-  int rc = sync_cvarSignal(id);
-  if (rc == ERROR){
+  int idx = id - MAX_LOCKS;
+  if (idx < 0 || idx >= MAX_CVARS || cvars[idx] == NULL){
     TracePrintf(3, "Unable to broadcast to cvar\n");
     return ERROR;
   }
 
-  //signal until signal returns 0 (implies no more waiters)
-  while (rc == 1){
-    rc = sync_cvarSignal(id);
-    if (rc == ERROR){
-      TracePrintf(3, "Failure signalling cvar\n");
-      return ERROR;
-    }
-  }
+  int woken = coord_wakeAll(&(cvars[idx]->waiters));
+  TracePrintf(8, "Broadcast woke %d\n", woken);
 
   TracePrintf(5, "EXIT sync_cvarBroadcast\n");
   return 0;
@@ -346,19 +337,14 @@ sync_reclaim(int id, int pid)
 
     //if creator of lock is one who wants to destroy, let them
     if (lock->creator == pid){
-      //free lock
-      free(locks[id]);
-      locks[id] = NULL;
-
-      //find all people waiting on lock and abort them
-      waiter = coord_findSyncWaiter(id, LOCK);
-      while (waiter != NULL){
-        if (coord_removeProcess(waiter->pid, BLOCKEDSYNC) != 1){
-          TracePrintf(2, "Couldn't remove process from blockedSync\n");
-        }
+      //abort all people waiting on lock (before its wait queue goes away)
+      while ((waiter = coord_getWaiter(&(lock->waiters))) != NULL){
         coord_abort(waiter, 0);
-        waiter = coord_findSyncWaiter(id, LOCK);
       }
+
+      //free lock
+      slab_free(&lockCache, locks[id]);
+      locks[id] = NULL;
     } else {
       TracePrintf(3, "Can't reclaim lock if not creator\n");
       return ERROR;
@@ -376,20 +362,14 @@ sync_reclaim(int id, int pid)
 
     //if creator of cvar is one who wants to destroy, let them
     if (cvar->creator == pid){
-      //free cvar
-      free(cvars[id - MAX_LOCKS]);
-      cvars[id - MAX_LOCKS] = NULL;
-
-      //find all people waiting on cvar and abort them
-      waiter = coord_findSyncWaiter(id, CVAR);
-      while (waiter != NULL){
-        if (coord_removeProcess(waiter->pid, BLOCKEDSYNC) != 1){
-          TracePrintf(2, "Couldn't remove process from blockedSync\n");
-        }
-
+      //abort all people waiting on cvar (before its wait queue goes away)
+      while ((waiter = coord_getWaiter(&(cvar->waiters))) != NULL){
         coord_abort(waiter, 0);
-        waiter = coord_findSyncWaiter(id, CVAR);
       }
+
+      //free cvar
+      slab_free(&cvarCache, cvars[id - MAX_LOCKS]);
+      cvars[id - MAX_LOCKS] = NULL;
     }
   }
 
@@ -407,23 +387,18 @@ sync_reclaim(int id, int pid)
       return ERROR;
     }
     TracePrintf(5, "sys_reclaim: reclaiming pipe %d (internal index %d)\n", id, pipe_index);
-    free(pipes[pipe_index]);
-    pipes[pipe_index] = NULL;
-    
-    //abort any processes waiting on this pipe.
-    waiter = coord_findSyncWaiter(id, PIPE);
-    while (waiter != NULL) {
-      if (coord_removeProcess(waiter->pid, BLOCKEDSYNC) != 1) {
-        TracePrintf(3, "sys_reclaim: couldn't remove process %d from blockedSync for pipe %d\n", waiter->pid, id);
-        return ERROR;
-      }
+
+    //abort any processes waiting on this pipe (before its wait queues go away).
+    while ((waiter = coord_getWaiter(&(p->readers))) != NULL || (waiter = coord_getWaiter(&(p->writers))) != NULL) {
       rc = coord_abort(waiter, 0);
       if (rc == ERROR) {
         TracePrintf(0, "sys_reclaim: failed to abort process %d waiting on pipe %d\n", waiter->pid, id);
         return ERROR;
       }
-      waiter = coord_findSyncWaiter(id, PIPE);
     }
+
+    slab_free(&pipeCache, pipes[pipe_index]);
+    pipes[pipe_index] = NULL;
   }
 
   TracePrintf(5, "EXIT sync_reclaim\n");
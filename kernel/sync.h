@@ -70,6 +70,25 @@ int sync_initLock();
 
 //-------------------------------------------------------
 
+/****************** sync_getWaiters ******************/
+/*
+ * wait queue of a lock or cvar
+ *
+ * input: 
+ *  int id - id of lock or cvar
+ *
+ * output:
+ *  return its wait queue (see coord_blockOn)
+ *  return NULL if no such lock or cvar
+ *
+ */
+
+//-------------------------------------------------------
+
+pcbQueue_t* sync_getWaiters(int id);
+
+//-------------------------------------------------------
+
 /****************** sync_lockAcquire ******************/
 /*
  * acquire a lock given by id
@@ -6,6 +6,7 @@
  *  all kernel sys calls 
  */
 
+#include <stddef.h>
 #include <ykernel.h>
 #include "sys.h"
 #include "memory.h"
@@ -14,6 +15,9 @@
 #include "codes.h"
 #include "loadprogram.h"
 #include "sync.h"
+#include "slab.h"
+#include "timer.h"
+#include "swap.h"
 
 #define ARG_LEN 20
 #define MAX_ARGS 12
@@ -25,6 +29,9 @@ tty_buffer_t tty_out_buffers[MAX_TTY];
 int tty_transmitting[MAX_TTY] = {0};
 pipe_t* pipes[MAX_PIPES] = {NULL};
 
+/*************** local functions ***************/
+void wakeFromDelay(ktimer_t* timer);
+
 /*************** sys_fork ***************/
 /*
  * see sys.h
@@ -35,23 +42,45 @@ sys_fork()
   //get the running process (will be the parent of process we are creating)
   pcb_t* parent = coord_getRunningProcess();
 
-  //malloc a pcb for child
-  pcb_t* child = malloc(sizeof(pcb_t));
+  //get a pcb for child (a recycled one, see below)
+  pcb_t* child = slab_alloc(&pcbCache);
   if (child == NULL) {
-    TracePrintf(1, "sys_fork: malloc failed for child PCB.\n");
+    TracePrintf(1, "sys_fork: alloc failed for child PCB.\n");
+    return ERROR;
+  }
+
+  //a dead process's teardown already cleared its per page state (mem_freeRegions),
+  //that's most of a pcb, so start everything else over from zero
+  memset(child, 0, offsetof(pcb_t, pageFlags));
+  memset(&(child->sampleCursor), 0, sizeof(pcb_t) - offsetof(pcb_t, sampleCursor));
+
+  //record parent gets when child exits
+  child->exitRecord = slab_alloc(&exitCache);
+  if (child->exitRecord == NULL) {
+    TracePrintf(1, "sys_fork: alloc failed for child exit record.\n");
+    slab_free(&pcbCache, child);
     return ERROR;
   }
-  memset(child, 0, sizeof(pcb_t));
 
   //initialize child pcb by copying info from parent
   child->parent = parent;
   child->brk = parent->brk;
   child->minBrk = parent->minBrk;
-  child->ttyReadWaiting = -1;
-  child->ttyWriteWaiting = -1;
-  child->abort = 0;
 
-  mem_newKernelStack(child); 
+  //child reads lazily loaded pages from the same program file
+  child->image = parent->image;
+  if (child->image != NULL) {
+    child->image->refs++;
+  }
+
+  //no kernel stack frames yet, so only the pcb and image hold need freeing
+  if (mem_newKernelStack(child) == ERROR) {
+    TracePrintf(1, "sys_fork: failed to allocate kernel stack for child.\n");
+    ReleaseImage(child->image);
+    slab_free(&exitCache, child->exitRecord);
+    slab_free(&pcbCache, child);
+    return ERROR;
+  }
 
   child->pt = mem_initUserPT();
   if (child->pt == NULL) {
@@ -60,7 +89,17 @@ sys_fork()
     return ERROR;
   }
   //copying parent's page table to child's page table
-  mem_copyPT(parent, child);
+  if (mem_copyPT(parent, child) == ERROR) {
+    TracePrintf(1, "sys_fork: failed to copy page table to child.\n");
+    mem_freePCB(child);
+    return ERROR;
+  }
+  //child keeps the parent's shared segments (pages already mapped by the copy)
+  if (shm_fork(parent, child) == ERROR) {
+    TracePrintf(1, "sys_fork: failed to share segments with child.\n");
+    mem_freePCB(child);
+    return ERROR;
+  }
   memcpy(&(child->uc), &(parent->uc), sizeof(UserContext));
 
   child->pid = helper_new_pid(child->pt);
@@ -90,6 +129,7 @@ sys_fork()
     //add child to necessary queues
     TracePrintf(7, "adding child to %x\n", parent->children);
     coord_addChild(parent, child);
+    coord_registerProcess(child);
 
     TracePrintf(7, "adding child to ready queue\n");
     coord_addProcess(child, READY);
@@ -126,6 +166,13 @@ sys_exec(char* file, char** args)
     return ERROR;
   }
 
+  //old address space is already gone, nothing to return to
+  if (loadStatus == KILL){
+    TracePrintf(1, "sys_exec: failed partway through load, aborting process %d.\n", curr->pid);
+    coord_abort(curr, ERROR);
+    return ERROR;
+  }
+
   TracePrintf(5, "EXIT sys_exec (success)\n");
   return(0);
 }
@@ -156,89 +203,50 @@ sys_wait(int* addr)
 {
   TracePrintf(5, "ENTER sys_wait\n");
 
-  int rc;
-
   pcb_t* curr = coord_getRunningProcess();
-  
-  //if the current process has no children, return error immediately.
-  if (curr->children == NULL) {
-    TracePrintf(0, "sys_wait: No children to wait for.\n");
-    curr->uc.regs[0] = ERROR;
-    return ERROR;
-  }
-  
-  //try to find a zombie child in the zombie queue.
-  pcb_t* child = curr->children;
-  while (child != NULL){
-
-    pcb_t* next = child->nextSibling;
-    //child found (and removed from zombie queue)
-    if (coord_removeProcess(child->pid, ZOMBIE) == 1){
-
-      //remove child from children
-      coord_removeChild(curr, child->pid);
 
-      //return to parent w/ info
-      curr->uc.regs[0] = child->pid;
-      if (addr != NULL){
-        *addr = child->exit;
-      }
-
-      child->parent = NULL;
-      //can pass in 0 because error code already collected (full abort anyways)
-      if (coord_abort(child, 0) == ERROR){
-        TracePrintf(0, "Failed to abort child\n");
-        //nothing we can do if abort fails, just keep chugging
-      }
-
-      TracePrintf(5, "EXIT sys_wait\n");
-      return 0;
+  //nothing has exited yet, block til a child does
+  while (curr->exited == NULL){
+    if (curr->children == NULL) {
+      TracePrintf(0, "sys_wait: No children to wait for.\n");
+      curr->uc.regs[0] = ERROR;
+      return ERROR;
     }
-    child = next;
-  }
-
-  //no zombie child found; block the calling process.
-  TracePrintf(0, "sys_wait: No zombie child found; blocking process.\n");
-  coord_addProcess(curr, BLOCKEDWAIT);
-  
-  //select the next process to run.
-  coord_scheduleProcess();
-
-  TracePrintf(3, "PID %d: Leaving wait, collecting child info\n", curr->pid);
-
-  //find first child in zombie queue (this is one that woke it)
-  child = curr->children;
-  while (child != NULL){
-
-    pcb_t* next = child->nextSibling;
-    //child found (and removed from zombie queue)
-    if (coord_removeProcess(child->pid, ZOMBIE) == 1){
-
-      //remove child from children
-      coord_removeChild(curr, child->pid);
 
-      //return to parent w/ info
-      curr->uc.regs[0] = child->pid;
-      if (addr != NULL){
-        *addr = child->exit;
-      }
+    TracePrintf(0, "sys_wait: No exited child found; blocking process.\n");
+    coord_addProcess(curr, BLOCKEDWAIT);
+    coord_scheduleProcess();
+  }
 
-      child->parent = NULL;
-      if (coord_abort(child, 0) == ERROR){
-        TracePrintf(0, "Failed to abort child\n");
+  //collect the child that exited first
+  exitRecord_t* record = curr->exited;
+  curr->exited = record->next;
+  TracePrintf(3, "PID %d: collecting child %d\n", curr->pid, record->pid);
+
+  //the status word may have been paged out while we were blocked,
+  //bring it back in before writing to it
+  if (addr != NULL){
+    int first = ((u_long)addr >> PAGESHIFT) - MAX_PT_LEN;
+    int last = (((u_long)addr + sizeof(int) - 1) >> PAGESHIFT) - MAX_PT_LEN;
+    for (int page = first; page <= last; page++){
+      if ((curr->pageFlags[page] & PAGE_SWAP) && swap_in(curr, page) == ERROR){
+        TracePrintf(0, "sys_wait: couldn't bring status page %d back in\n", page);
+        curr->exited = record; //leave the child for a later Wait
+        curr->uc.regs[0] = ERROR;
         return ERROR;
       }
-
-      TracePrintf(5, "EXIT sys_wait\n");
-      return 0;
     }
-    child = next;
   }
 
+  //return to parent w/ info
+  curr->uc.regs[0] = record->pid;
+  if (addr != NULL){
+    *addr = record->status;
+  }
+  slab_free(&exitCache, record);
 
-  TracePrintf(5, "PID %d: I woke up but can't find child that alerted me\n");
-  TracePrintf(5, "EXIT sys_wait (error)\n");
-  return ERROR;
+  TracePrintf(5, "EXIT sys_wait\n");
+  return 0;
 }
 
 /*************** sys_getPid ***************/
@@ -283,8 +291,10 @@ sys_brk(int brk)
   //growing the heap: newBreak > currentPCB->brk.
   if (brk > currentPCB->brk) {
     TracePrintf(7, "sys_brk: Growing heap from page %d to page %d.\n", currentPCB->brk, brk);
-    for (int page = currentPCB->brk; page < brk; page++) {
-      mem_setUserPTE(currentPCB->pt, page, (PROT_READ | PROT_WRITE));
+    //only reserve the range, frames come on first write
+    if (mem_mapZeroPages(currentPCB, currentPCB->brk, brk - currentPCB->brk) == ERROR) {
+      TracePrintf(1, "sys_brk: failed to map heap pages.\n");
+      return ERROR;
     }
     currentPCB->brk = brk;
   }
@@ -292,15 +302,24 @@ sys_brk(int brk)
   else if (brk < currentPCB->brk) {
     TracePrintf(7, "sys_brk: Shrinking heap from page %d to %d.\n", currentPCB->brk, brk);
     for (int page = currentPCB->brk - 1; page >= brk; page--){
-      if (mem_freePTE(currentPCB->pt, page) == ERROR){
+      swap_dropPage(currentPCB, page);
+      if (currentPCB->pt[page].valid && mem_freePTE(currentPCB->pt, page) == ERROR){
         TracePrintf(5, "sys_brk: free failed, but continue\n");
       }
+      currentPCB->pageFlags[page] = 0;
+      currentPCB->pageAge[page] = 0;
     }
     currentPCB->brk = brk;
   }
   else {
     TracePrintf(2, "sys_brk: New break equals current break (%d); no change.\n", currentPCB->brk);
   }
+
+  //heap region runs from the initial break to the new one
+  vma_t* heap = mem_getVMA(currentPCB, VMA_HEAP);
+  if (heap != NULL){
+    heap->numPages = currentPCB->brk - heap->firstPage;
+  }
   
   //flush the TLB after updating the page table.
   WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
@@ -331,11 +350,12 @@ int sys_delay(int delay_ticks) {
     return 0;
   }
 
-  //calculate the wake time based on the current global clock tick.
-  currentPCB->wakeTime = currentClockTick + delay_ticks;
-  TracePrintf(7, "sys_delay: Process will wake at tick %d (current tick: %d, delay: %d).\n", currentPCB->wakeTime, currentClockTick, delay_ticks);
+  //set a timer for the wake time based on the current global clock tick.
+  int wakeTime = currentClockTick + delay_ticks;
+  timer_add(&(currentPCB->delayTimer), wakeTime, wakeFromDelay, currentPCB);
+  TracePrintf(7, "sys_delay: Process will wake at tick %d (current tick: %d, delay: %d).\n", wakeTime, currentClockTick, delay_ticks);
 
-  //enqueue the current process into the BLOCKEDDELAY queue.
+  //enqueue the current process into the BLOCKEDDELAY queue (the timer takes it off).
   coord_addProcess(currentPCB, BLOCKEDDELAY);
   TracePrintf(7, "sys_delay: Process enqueued into BLOCKEDDELAY queue.\n");
 
@@ -369,16 +389,12 @@ sys_ttyRead(int tty_id, void *buf, int len)
     TracePrintf(7, "sys_ttyRead: No data available on tty %d; blocking process.\n", tty_id);
     pcb_t *currentPCB = coord_getRunningProcess();
 
-    //mark this process as waiting for input on tty.
-    currentPCB->ttyReadWaiting = tty_id;
-    coord_addProcess(currentPCB, BLOCKEDIO);
+    //wait in line for input on tty (waiting on a user is what interactive processes do).
+    coord_promote(currentPCB);
+    coord_blockOn(currentPCB, &(tty->waiters), BLOCKEDIO);
     coord_scheduleProcess();
   }
 
-  //when the process resumes, clear the waiting flag.
-  pcb_t *currentPCB = coord_getRunningProcess();
-  currentPCB->ttyReadWaiting = -1;
-
   int bytes_to_copy = (tty->count < len) ? tty->count : len;
   memcpy(buf, tty->buf, bytes_to_copy);
 
@@ -389,6 +405,11 @@ sys_ttyRead(int tty_id, void *buf, int len)
   }
   tty->count = remaining;
 
+  //input left over, next reader in line can have it
+  if (remaining > 0) {
+    coord_wakeOne(&(tty->waiters));
+  }
+
   TracePrintf(5, "sys_ttyRead: Read %d bytes from tty %d\n", bytes_to_copy, tty_id);
   return bytes_to_copy;
 }
@@ -406,13 +427,14 @@ sys_ttyWrite(int tty_id, void *buf, int len) {
   }
 
   pcb_t* currentPCB = coord_getRunningProcess();
-  currentPCB->ttyWriteWaiting = tty_id;
+  tty_buffer_t* out = &tty_out_buffers[tty_id];
 
-  //wait for terminal to open
-  while (tty_transmitting[tty_id]) {
-      coord_addProcess(currentPCB, BLOCKEDIO);
+  //wait for terminal to open (writers go in turn, whole writes at a time)
+  while (out->writer != NULL) {
+      coord_blockOn(currentPCB, &(out->waiters), BLOCKEDIO);
       coord_scheduleProcess();
   }
+  out->writer = currentPCB;
   
   int total_written = 0;
   while (total_written < len) {
@@ -421,6 +443,8 @@ sys_ttyWrite(int tty_id, void *buf, int len) {
     void *kbuf = malloc(chunk);
     if (kbuf == NULL) {
       TracePrintf(0, "sys_ttyWrite: malloc failed for chunk\n");
+      out->writer = NULL;
+      coord_wakeOne(&(out->waiters));
       return ERROR;
     }
     memcpy(kbuf, (char*)buf + total_written, chunk);
@@ -430,19 +454,20 @@ sys_ttyWrite(int tty_id, void *buf, int len) {
     TtyTransmit(tty_id, kbuf, chunk);
 
 
-    //set waiting flag for write.
-    //block until the transmit flag is cleared (by the transmit interrupt).
+    //block until the transmit flag is cleared (by the transmit interrupt, which wakes the writer).
     while (tty_transmitting[tty_id]) {
       coord_addProcess(currentPCB, BLOCKEDIO);
       coord_scheduleProcess();
     }
-    //clear waiting flag.
-    currentPCB->ttyWriteWaiting = -1;
 
     free(kbuf);
     total_written += chunk;
   }
 
+  //terminal is free, next writer in line
+  out->writer = NULL;
+  coord_wakeOne(&(out->waiters));
+
   TracePrintf(5, "sys_ttyWrite: transmission complete on tty %d, total len = %d\n", tty_id, total_written);
   return total_written;
 }
@@ -465,16 +490,15 @@ sys_pipeInit(int *pipe_idp) {
     return ERROR;
   }
   
-  pipe_t *p = malloc(sizeof(pipe_t));
+  //comes with no lock and no one waiting, empty it
+  pipe_t *p = slab_alloc(&pipeCache);
   if (p == NULL) {
-    TracePrintf(1, "sys_pipeInit: malloc failed\n");
+    TracePrintf(1, "sys_pipeInit: alloc failed\n");
     return ERROR;
   }
   p->read_index = 0;
   p->write_index = 0;
   p->count = 0;
-  memset(p->buf, 0, PIPE_BUFFER_LEN);
-  p->lock = -1;
   
   p->creator = current->pid; //record the creator's pid
   
@@ -512,7 +536,8 @@ sys_pipeRead(int pipe_id, void *buf, int len)
   //block until there is at least one byte available.
   while (p->count == 0) {
     TracePrintf(2, "sys_pipeRead: pipe %d empty; blocking process %d\n", pipe_id, current->pid);
-    coord_addProcess(current, BLOCKEDIO);
+    coord_promote(current);
+    coord_blockOn(current, &(p->readers), BLOCKEDIO);
     coord_scheduleProcess();
     //recheck the condition when resumed.
   }
@@ -529,11 +554,13 @@ sys_pipeRead(int pipe_id, void *buf, int len)
   p->count -= bytes_copied;
   TracePrintf(2, "sys_pipeRead: read %d bytes from pipe %d (internal idx %d)\n", bytes_copied, pipe_id, idx);
   
-  //unblock one process waiting on a pipe write, if any.
-  pcb_t *proc = coord_getProcess(BLOCKEDIO);
-  if (proc != NULL) {
-    coord_addProcess(proc, READY);
+  //bytes left over go to the next reader in line.
+  if (p->count > 0) {
+    coord_wakeOne(&(p->readers));
   }
+
+  //writers each need a different amount of room, let them all check.
+  coord_wakeAll(&(p->writers));
   
   return bytes_copied;
 }
@@ -562,7 +589,8 @@ sys_pipeWrite(int pipe_id, void *buf, int len)
   //block if there isn’t enough space.
   while (p->count + len > PIPE_BUFFER_LEN) {
     TracePrintf(2, "sys_pipeWrite: pipe %d full; blocking process %d\n", pipe_id, current->pid);
-    coord_addProcess(current, BLOCKEDIO);
+    coord_promote(current);
+    coord_blockOn(current, &(p->writers), BLOCKEDIO);
     coord_scheduleProcess();
     //re-check available space.
   }
@@ -576,11 +604,8 @@ sys_pipeWrite(int pipe_id, void *buf, int len)
   p->count += bytes_written;
   TracePrintf(2, "sys_pipeWrite: wrote %d bytes to pipe %d (internal idx %d)\n", bytes_written, pipe_id, idx);
   
-  //unblock one process waiting on pipe read, if any.
-  pcb_t *proc = coord_getProcess(BLOCKEDIO);
-  if (proc != NULL) {
-    coord_addProcess(proc, READY);
-  }
+  //unblock one process waiting on pipe read, if any (it passes on what it leaves).
+  coord_wakeOne(&(p->readers));
   return bytes_written;
 }
 
@@ -596,7 +621,7 @@ sys_freePipes(void)
   //iterate through all pipes and free
   for (int i = 0; i < MAX_PIPES; i++) {
     if (pipes[i] != NULL) {
-      free(pipes[i]);
+      slab_free(&pipeCache, pipes[i]);
       pipes[i] = NULL;
       TracePrintf(5, "free_all_pipes: Freed pipe at index %d\n", i);
     }
@@ -643,9 +668,8 @@ sys_lockAcquire(int id)
     return ERROR;
   }
 
-  curr->lockID = id;
   while (acquired != 1){
-    rc = coord_addProcess(curr, BLOCKEDSYNC);
+    rc = coord_blockOn(curr, sync_getWaiters(id), BLOCKEDSYNC);
     if (rc == ERROR){
       TracePrintf(0, "Can't add process to blocked sync\n");
       return ERROR;
@@ -656,7 +680,6 @@ sys_lockAcquire(int id)
     acquired = sync_lockAcquire(id, curr->pid);
     if (acquired == ERROR){
       TracePrintf(0, "Lock doesn't exist\n");
-      curr->lockID = -1;
       return ERROR;
     }
   }
@@ -756,7 +779,12 @@ sys_cvarWait(int cvarID, int lockID)
 
   pcb_t* curr = coord_getRunningProcess();
 
-  curr->cvarID = cvarID;
+  //only cvars can be waited on
+  pcbQueue_t* waiters = sync_getWaiters(cvarID);
+  if (cvarID < MAX_LOCKS || waiters == NULL){
+    TracePrintf(2, "Cvar %d doesn't exist\n", cvarID);
+    return ERROR;
+  }
 
   int rc;
   TracePrintf(5, "LOCKID %d\n", lockID);
@@ -766,7 +794,7 @@ sys_cvarWait(int cvarID, int lockID)
     return ERROR;
   }
 
-  rc = coord_addProcess(curr, BLOCKEDSYNC);
+  rc = coord_blockOn(curr, waiters, BLOCKEDSYNC);
   if (rc == ERROR){
     TracePrintf(0, "Can't add process to blocked sync\n");
     return ERROR;
@@ -782,9 +810,8 @@ sys_cvarWait(int cvarID, int lockID)
     return ERROR;
   }
 
-  curr->lockID = lockID;
   while (acquired != 1){
-    rc = coord_addProcess(curr, BLOCKEDSYNC);
+    rc = coord_blockOn(curr, sync_getWaiters(lockID), BLOCKEDSYNC);
     if (rc == ERROR){
       TracePrintf(0, "Can't add process to blocked sync\n");
       return ERROR;
@@ -795,7 +822,6 @@ sys_cvarWait(int cvarID, int lockID)
     acquired = sync_lockAcquire(lockID, curr->pid);
     if (acquired == ERROR){
       TracePrintf(0, "Lock doesn't exist\n");
-      curr->lockID = -1;
       return ERROR;
     }
   }
@@ -830,3 +856,88 @@ sys_reclaim(int id)
 
 }
 
+/*************** sys_sharedPages ***************/
+/*
+ * see sys.h
+ */
+int
+sys_sharedPages(int key, int numPages)
+{
+  TracePrintf(5, "ENTER sys_sharedPages\n");
+
+  pcb_t* curr = coord_getRunningProcess();
+
+  int page = shm_attach(curr, key, numPages);
+  if (page == ERROR){
+    TracePrintf(1, "sys_sharedPages: couldn't map segment %d\n", key);
+    return ERROR;
+  }
+
+  TracePrintf(5, "EXIT sys_sharedPages\n");
+  return (page << PAGESHIFT) + VMEM_1_BASE;
+}
+
+/*************** sys_memStats ***************/
+/*
+ * see sys.h
+ */
+int
+sys_memStats(int* buf, int count)
+{
+  TracePrintf(5, "ENTER sys_memStats\n");
+
+  int stats[MEMSTAT_COUNT];
+  mem_getStats(stats);
+
+  //callers built against fewer stats just get the ones they know about
+  if (count > MEMSTAT_COUNT){
+    count = MEMSTAT_COUNT;
+  }
+  memcpy(buf, stats, count * sizeof(int));
+
+  TracePrintf(5, "EXIT sys_memStats\n");
+  return count;
+}
+
+/*************** sys_clockStats ***************/
+/*
+ * see sys.h
+ */
+int
+sys_clockStats(int* buf, int count)
+{
+  TracePrintf(5, "ENTER sys_clockStats\n");
+
+  int stats[CLOCKSTAT_COUNT];
+  stats[CLOCKSTAT_TICK] = currentClockTick;
+  timer_getStats(stats);
+  coord_getStats(stats);
+
+  if (count > CLOCKSTAT_COUNT){
+    count = CLOCKSTAT_COUNT;
+  }
+  memcpy(buf, stats, count * sizeof(int));
+
+  TracePrintf(5, "EXIT sys_clockStats\n");
+  return count;
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** wakeFromDelay ********************/
+/*
+ * delay timer went off, move its process to ready
+ *
+ * input:
+ *  timer - delay timer of the process (arg is its pcb)
+ *
+ */
+void
+wakeFromDelay(ktimer_t* timer)
+{
+  pcb_t* pcb = (pcb_t*)timer->arg;
+  TracePrintf(2, "wakeFromDelay: Unblocking process %d (wakeTime %d).\n", pcb->pid, timer->expires);
+  coord_addProcess(pcb, READY);
+}
@@ -16,6 +16,9 @@
 #include "codes.h"
 #include "loadprogram.h"
 #include "sync.h"
+#include "swap.h"
+#include "shm.h"
+#include "clockstats.h"
 
 
 /*************** sys_fork ***************/
@@ -460,5 +463,64 @@ int sys_reclaim(int id);
 
 //---------------------------------------------
 
+/****************** sys_sharedPages ******************/
+/*
+ *   Maps a shared memory segment into the calling process, making
+ *   it first if it doesn't exist. Segments stay mapped across fork.
+ *
+ * Parameters:
+ *   key - name of the segment, SHM_ANON for a new unnamed one.
+ *   numPages - pages to map (0 maps all of an existing segment).
+ *
+ * Returns:
+ *   address the segment starts at.
+ *   ERROR if the segment can't be made or doesn't fit.
+ * 
+ */
+
+//---------------------------------------------
+
+int sys_sharedPages(int key, int numPages);
+
+//---------------------------------------------
+
+/****************** sys_memStats ******************/
+/*
+ *   Copies out how physical memory is being used (Custom1).
+ *
+ * Parameters:
+ *   buf - where to put the stats, laid out as in memstats.h.
+ *   count - most stats buf holds.
+ *
+ * Returns:
+ *   number of stats copied (at most MEMSTAT_COUNT).
+ * 
+ */
+
+//---------------------------------------------
+
+int sys_memStats(int* buf, int count);
+
+//---------------------------------------------
+
+/****************** sys_clockStats ******************/
+/*
+ *   Copies out the clock tick, timer and scheduler counts (Custom2).
+ *
+ * Parameters:
+ *   buf - where to put the stats, laid out as in clockstats.h.
+ *   count - most stats buf holds.
+ *
+ * Returns:
+ *   number of stats copied (at most CLOCKSTAT_COUNT).
+ * 
+ */
+
+//---------------------------------------------
+
+int sys_clockStats(int* buf, int count);
+
+//---------------------------------------------
+
 #endif
 
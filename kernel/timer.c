@@ -0,0 +1,238 @@
+/*
+ * file: timer.c
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  a two level timer wheel. level 0 has a slot for each of the
+ *  next TIMER_WHEEL_SLOTS ticks, level 1 a slot for each of the
+ *  next TIMER_WHEEL_SLOTS laps of level 0. every lap, the level
+ *  1 slot coming up is spread out over level 0, so each tick
+ *  only fires the timers in its own slot
+ */
+
+#include <ykernel.h>
+#include "timer.h"
+#include "codes.h"
+#include "structs.h"
+
+/***************** globals *****************/
+ktimer_t* wheel0[TIMER_WHEEL_SLOTS]; //timers due in the next lap, by tick
+ktimer_t* wheel1[TIMER_WHEEL_SLOTS]; //timers due in later laps, by lap
+ktimer_t* overflow; //timers due after that
+
+int lastTick; //last tick timer_tick handled
+int timersFired;
+int timersCascaded; //times a timer moved down a level
+int timersMaxFired; //most fired on one tick
+
+/******************* local funcs *******************/
+void place(ktimer_t* timer, int earliest);
+void pushTimer(ktimer_t** bucket, ktimer_t* timer);
+void cascade(ktimer_t** bucket);
+
+/***************** timer_add *****************/
+/*
+ * see timer.h for description
+ */
+void
+timer_add(ktimer_t* timer, int expires, void (*fire)(ktimer_t*), void* arg)
+{
+  timer_cancel(timer);
+
+  timer->expires = expires;
+  timer->fire = fire;
+  timer->arg = arg;
+
+  //this tick's slot may already have fired, so the soonest it can go off is next tick
+  place(timer, lastTick + 1);
+}
+
+/***************** timer_cancel *****************/
+/*
+ * see timer.h for description
+ */
+void
+timer_cancel(ktimer_t* timer)
+{
+  if (timer->bucket == NULL){
+    return;
+  }
+
+  if (timer->prev != NULL){
+    timer->prev->next = timer->next;
+  } else {
+    *(timer->bucket) = timer->next;
+  }
+  if (timer->next != NULL){
+    timer->next->prev = timer->prev;
+  }
+
+  timer->next = NULL;
+  timer->prev = NULL;
+  timer->bucket = NULL;
+}
+
+/***************** timer_tick *****************/
+/*
+ * see timer.h for description
+ */
+int
+timer_tick(int now)
+{
+  int fired = 0;
+
+  //catch up one tick at a time, nothing is due between slots
+  while (lastTick < now){
+    lastTick++;
+
+    //new level 1 lap, see if far off timers are close enough for the wheel
+    if (lastTick % (TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS) == 0){
+      cascade(&overflow);
+    }
+
+    //new level 0 lap, spread this lap's level 1 slot over level 0
+    if (lastTick % TIMER_WHEEL_SLOTS == 0){
+      cascade(&wheel1[(lastTick / TIMER_WHEEL_SLOTS) % TIMER_WHEEL_SLOTS]);
+    }
+
+    //everything in this slot is due now (fire may re-arm, so unhook first)
+    ktimer_t** slot = &wheel0[lastTick % TIMER_WHEEL_SLOTS];
+    while (*slot != NULL){
+      ktimer_t* timer = *slot;
+      timer_cancel(timer);
+      TracePrintf(5, "timer_tick: timer due on tick %d fired on tick %d\n", timer->expires, lastTick);
+      timer->fire(timer);
+      fired++;
+    }
+  }
+
+  timersFired += fired;
+  if (fired > timersMaxFired){
+    timersMaxFired = fired;
+  }
+  return fired;
+}
+
+/***************** timer_getStats *****************/
+/*
+ * see timer.h for description
+ */
+void
+timer_getStats(int* stats)
+{
+  stats[CLOCKSTAT_TIMERS_FIRED] = timersFired;
+  stats[CLOCKSTAT_TIMERS_MOVED] = timersCascaded;
+}
+
+/***************** timer_exit *****************/
+/*
+ * see timer.h for description
+ */
+void
+timer_exit()
+{
+  TracePrintf(1, "timers: %d fired (at most %d on one tick), %d moved down the wheel\n",
+      timersFired, timersMaxFired, timersCascaded);
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** place ********************/
+/*
+ * put an unarmed timer in the slot (or overflow list) for
+ *  how far off it is
+ *
+ * input:
+ *  timer - timer with expires set
+ *  earliest - soonest tick it may fire on (timers already
+ *   due go in this tick's slot)
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  timer_add passes the next tick. cascade passes lastTick,
+ *   since it runs before lastTick's slot fires, so a timer
+ *   moving down on the tick it's due still goes off on time
+ *
+ */
+void
+place(ktimer_t* timer, int earliest)
+{
+  int delta = timer->expires - lastTick;
+
+  //already due, soonest allowed tick it is
+  if (timer->expires <= earliest){
+    pushTimer(&wheel0[earliest % TIMER_WHEEL_SLOTS], timer);
+  }
+  else if (delta < TIMER_WHEEL_SLOTS){
+    pushTimer(&wheel0[timer->expires % TIMER_WHEEL_SLOTS], timer);
+  }
+  else if (delta < TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS){
+    pushTimer(&wheel1[(timer->expires / TIMER_WHEEL_SLOTS) % TIMER_WHEEL_SLOTS], timer);
+  }
+  else {
+    pushTimer(&overflow, timer);
+  }
+}
+
+/******************** pushTimer ********************/
+/*
+ * add a timer to the front of a slot
+ *
+ * input:
+ *  bucket - slot (or overflow list)
+ *  timer - unarmed timer
+ *
+ * output:
+ *  none
+ *
+ */
+void
+pushTimer(ktimer_t** bucket, ktimer_t* timer)
+{
+  timer->prev = NULL;
+  timer->next = *bucket;
+  if (*bucket != NULL){
+    (*bucket)->prev = timer;
+  }
+  *bucket = timer;
+  timer->bucket = bucket;
+}
+
+/******************** cascade ********************/
+/*
+ * empty a slot, placing each of its timers again now that
+ *  they're closer
+ *
+ * input:
+ *  bucket - slot (or overflow list) to empty
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  timers can land back in the same slot (overflow ones
+ *   still far off), so the slot is detached first. called
+ *   before the tick's own level 0 slot fires, timers due
+ *   this tick land in it
+ *
+ */
+void
+cascade(ktimer_t** bucket)
+{
+  ktimer_t* timer = *bucket;
+  *bucket = NULL;
+
+  while (timer != NULL){
+    ktimer_t* next = timer->next;
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->bucket = NULL;
+    place(timer, lastTick);
+    timersCascaded++;
+    timer = next;
+  }
+}
@@ -0,0 +1,122 @@
+/*
+ * file: timer.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  interface for timer.c (timeouts on a timer wheel)
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <ykernel.h>
+#include "codes.h"
+#include "structs.h"
+#include "clockstats.h"
+
+/********************* timer_add *********************/
+/*
+ * arm a timer to go off on a given clock tick
+ *
+ * input:
+ *  timer - timer to arm (re-armed if already pending)
+ *  expires - clock tick to fire on (past ticks fire on the
+ *   next one)
+ *  fire - called from the clock handler when it goes off
+ *  arg - stored in the timer for fire
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  O(1), timers due more than TIMER_WHEEL_SLOTS^2 ticks out
+ *   sit on an overflow list looked at once a level 1 lap
+ *
+ */
+
+//-------------------------------------------------------
+
+void timer_add(ktimer_t* timer, int expires, void (*fire)(ktimer_t*), void* arg);
+
+//-------------------------------------------------------
+
+/********************* timer_cancel *********************/
+/*
+ * disarm a timer before it goes off
+ *
+ * input:
+ *  timer - timer to disarm (nothing happens if not armed)
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void timer_cancel(ktimer_t* timer);
+
+//-------------------------------------------------------
+
+/********************* timer_tick *********************/
+/*
+ * fire every timer due up to the given tick
+ *
+ * input:
+ *  now - current clock tick
+ *
+ * output:
+ *  return number of timers fired
+ *
+ * notes:
+ *  called once per clock interrupt. only the slot for each
+ *   tick is looked at, so the cost doesn't grow with the
+ *   number of timers waiting (beyond one level 1 slot moving
+ *   down every TIMER_WHEEL_SLOTS ticks)
+ *
+ */
+
+//-------------------------------------------------------
+
+int timer_tick(int now);
+
+//-------------------------------------------------------
+
+/********************* timer_getStats *********************/
+/*
+ * report timer counts
+ *
+ * input:
+ *  stats - filled in at CLOCKSTAT_TIMERS_FIRED and
+ *   CLOCKSTAT_TIMERS_MOVED (see clockstats.h)
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void timer_getStats(int* stats);
+
+//-------------------------------------------------------
+
+/********************* timer_exit *********************/
+/*
+ * report timer stats on the way down
+ *
+ * input:
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void timer_exit();
+
+//-------------------------------------------------------
+
+#endif
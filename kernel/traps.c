@@ -12,9 +12,11 @@
 #include "codes.h"
 #include "stubs.h"
 #include "sys.h"
+#include "dedup.h"
+#include "workset.h"
+#include "timer.h"
 
 /******************* extern variables *******************/
-extern processes_t* processes;
 extern int currentClockTick;
 
 /******************** trap_initTable ********************/
@@ -69,6 +71,9 @@ trap_kernelHandler(UserContext* uc)
   pcb_t* curr = coord_getRunningProcess();
   curr->uc = *uc;
 
+  //kernel may use this process's memory til the call is done, keep it paged in
+  curr->pinned = 1;
+
   TracePrintf(3, "uc->code = %x\n", uc->code);
 
   //call the associated syscall handler stub function
@@ -174,13 +179,38 @@ trap_kernelHandler(UserContext* uc)
       stub_reclaim();
       break;
 
+    case YALNIX_SHARED_PAGES:
+      TracePrintf(3, "trap_kernelHandler: Handling YALNIX_SHARED_PAGES %x\n", YALNIX_SHARED_PAGES);
+      stub_sharedPages();
+      break;
+
+    //named shared segments, Custom0(key, numPages, 0, 0)
+    case YALNIX_CUSTOM_0:
+      TracePrintf(3, "trap_kernelHandler: Handling YALNIX_CUSTOM_0 (shared attach) %x\n", YALNIX_CUSTOM_0);
+      stub_sharedAttach();
+      break;
+
+    //physical memory stats, Custom1(buf, count, 0, 0)
+    case YALNIX_CUSTOM_1:
+      TracePrintf(3, "trap_kernelHandler: Handling YALNIX_CUSTOM_1 (memory stats) %x\n", YALNIX_CUSTOM_1);
+      stub_memStats();
+      break;
+
+    //clock tick, timer and scheduler stats, Custom2(buf, count, 0, 0)
+    case YALNIX_CUSTOM_2:
+      TracePrintf(3, "trap_kernelHandler: Handling YALNIX_CUSTOM_2 (clock stats) %x\n", YALNIX_CUSTOM_2);
+      stub_clockStats();
+      break;
+
     default:
       TracePrintf(0, "trap_kernelHandler recieved an invalid code %d.\n", uc->code);
       break;
   }
 
   //copy current user context back into user context passed in
+  //(whoever is running now is back on its way to user land)
   curr = coord_getRunningProcess();
+  curr->pinned = 0;
   *uc = curr->uc;
 
   TracePrintf(5, "EXIT trap_kernelHandler\n");
@@ -204,32 +234,26 @@ trap_clockHandler(UserContext* uc)
   pcb_t* curr = coord_getRunningProcess();
   curr->uc = *uc;
 
-  // --- Unblock delayed processes ---
-  pcb_t* prev = NULL;
-  pcb_t* cur = processes->blockedDelay;
-  while (cur != NULL) {
-    if (cur->wakeTime <= currentClockTick) {
-      TracePrintf(2, "trap_clockHandler: Unblocking process %d (wakeTime %d <= currentTick %d).\n", cur->pid, cur->wakeTime, currentClockTick);
-      //remove 'cur' from the blocked delay queue.
-      if (prev == NULL) {
-        processes->blockedDelay = cur->next;
-      } else {
-        prev->next = cur->next;
-      }
-      pcb_t* toUnblock = cur;
-      cur = cur->next;  //advance before processing toUnblock
-  
-      //add the unblocked process to the ready queue.
-      coord_addProcess(toUnblock, READY);
-    } else {
-      prev = cur;
-      cur = cur->next;
-    }
+  //sample page use for the working set estimate (never blocks, so any tick will do)
+  ws_sample();
+
+  //free some dead processes, and if nobody else wanted the cpu this tick, merge duplicate pages and zero some frames
+  //(paging out from here only when idle, it can't block on the disk)
+  if (curr == coord_getIdlePCB()){
+    mem_drainReclaim(RECLAIM_IDLE_BATCH);
+    mem_checkWatermarks(1);
+    dedup_scan(DEDUP_PAGES_PER_TICK);
+    mem_fillZeroPool(ZERO_POOL_BATCH);
+  } else {
+    mem_drainReclaim(RECLAIM_BATCH);
+    mem_checkWatermarks(0);
   }
-  // --- End Unblocking ---
 
-  //schedule next process to run
-  coord_scheduleProcess();
+  //wake delayed processes whose time is up
+  timer_tick(currentClockTick);
+
+  //schedule next process to run (if the scheduler wants a switch this tick)
+  coord_clockTick();
 
   //set user context to running user context of running process
   curr = coord_getRunningProcess();
@@ -280,7 +304,10 @@ trap_memoryHandler(UserContext* uc)
   u_long offendingAddr = (u_long)uc->addr;
   int offendingPage = (((u_long)offendingAddr) >> PAGESHIFT) - MAX_PT_LEN;
   TracePrintf(5, "OFFENDING PAGE = %d\n", offendingPage);
-  int stackBrk = mem_getStackBrk(curr->pt);
+  int stackBrk = mem_getStackBrk(curr);
+
+  //region the page belongs to (NULL if it's in none)
+  vma_t* vma = (offendingPage >= 0 && offendingPage < MAX_PT_LEN) ? mem_findVMA(curr, offendingPage) : NULL;
 
   //int kernelBrk = 
 
@@ -305,18 +332,35 @@ trap_memoryHandler(UserContext* uc)
       rc = coord_abort(curr, ERROR);
     }
 
-    //below User Stack, try stack growth, else abort
-    else if (offendingPage <= stackBrk && offendingPage > (curr->brk + 1)){
+    //page was paged out, bring it back from the compressed store or swap
+    else if (vma != NULL && (curr->pageFlags[offendingPage] & PAGE_SWAP)){
+      TracePrintf(3, "Swapping in page %d\n", offendingPage);
+      curr->pinned = 1;
+      if (swap_in(curr, offendingPage) == ERROR){
+        TracePrintf(3, "Failed to swap in page\n");
+        rc = coord_abort(curr, ERROR);
+      }
+      curr->pinned = 0;
+    }
+
+    //text or data page not read in yet, load it from program file
+    else if (vma != NULL && (curr->pageFlags[offendingPage] & PAGE_FILE)){
+      TracePrintf(3, "Loading page %d from program file\n", offendingPage);
+      if (LoadPage(curr, offendingPage) == ERROR){
+        TracePrintf(3, "Failed to load page\n");
+        rc = coord_abort(curr, ERROR);
+      }
+    }
+
+    //below User Stack, try stack growth (not through a shared segment), else abort
+    else if (vma == NULL && offendingPage <= stackBrk && offendingPage > (curr->brk + 1) && !shm_overlaps(curr, offendingPage, stackBrk)){
       TracePrintf(3, "curr->brk: %d\n", curr->brk);
       TracePrintf(3, "Addr between user brk (+2) and stack\n");
       TracePrintf(3, "Growing stack\n");
 
-      for (int page = stackBrk; page >= offendingPage; page--){
-        rc = mem_setUserPTE(curr->pt, page, (PROT_WRITE | PROT_READ));
-        if (rc == ERROR){
-          TracePrintf(3, "Failed to grow stack\n");
-          rc = coord_abort(curr, ERROR);
-        }
+      if (mem_growStack(curr, offendingPage) == ERROR){
+        TracePrintf(3, "Failed to grow stack\n");
+        rc = coord_abort(curr, ERROR);
       }
 
       //some weird other case not accounted for yet, ABORT
@@ -330,10 +374,18 @@ trap_memoryHandler(UserContext* uc)
 
   //invalid access perms
   else if (curr->uc.code == YALNIX_ACCERR){
-    //add checks for COW and such here, but for now, if incorrect permissions, you don't
-    //get to access that memory no matter what
-    TracePrintf(5, "Incorrect permissions to access page %d\n", offendingPage);
-    rc = coord_abort(curr, ERROR);
+    //a page the working set sampler took away just gets its protection back,
+    //a write to a copy on write page gets its own frame, otherwise
+    //if incorrect permissions, you don't get to access that memory
+    if (ws_fault(curr, offendingPage) == 1){
+      TracePrintf(3, "Page %d was being sampled\n", offendingPage);
+    }
+    else if (mem_handleWriteFault(curr, offendingPage) == 1){
+      TracePrintf(3, "Resolved write fault on page %d\n", offendingPage);
+    } else {
+      TracePrintf(5, "Incorrect permissions to access page %d\n", offendingPage);
+      rc = coord_abort(curr, ERROR);
+    }
   }
 
   else {
@@ -406,11 +458,7 @@ trap_ttyReceiveHandler(UserContext* uc)
   TracePrintf(2, "trap_ttyReceiveHandler: tty_buffers[%d].count now = %d\n", tty, tb->count);
 
   //unblock one process waiting on read.
-  pcb_t* target = coord_findTtyReadWaiter(tty);
-  if (target != NULL){
-    coord_removeProcess(target->pid, BLOCKEDIO);
-    coord_addProcess(target, READY);
-  }
+  coord_wakeOne(&(tb->waiters));
 }
 
 /******************** trap_ttyTransmitHandler ********************/
@@ -432,10 +480,9 @@ trap_ttyTransmitHandler(UserContext* uc) {
   tty_out_buffers[tty].count = 0;
   memset(tty_out_buffers[tty].buf, 0, TERMINAL_MAX_LINE);
 
-  //unblock one process waiting for write.
-  pcb_t* target = coord_findTtyWriteWaiter(tty);
-  if (target != NULL){
-    coord_removeProcess(target->pid, BLOCKEDIO);
+  //unblock the process whose write this was.
+  pcb_t* target = tty_out_buffers[tty].writer;
+  if (target != NULL && coord_containsProcess(target, BLOCKEDIO) == 1){
     coord_addProcess(target, READY);
   }
 
@@ -448,8 +495,12 @@ trap_ttyTransmitHandler(UserContext* uc) {
 void
 trap_diskHandler(UserContext* uc)
 {
-  TracePrintf(0, "trap not handled yet\n");
-  helper_abort("not implemented yet\n");
+  TracePrintf(5, "ENTER trap_diskHandler\n");
+
+  //sector done, swap moves its request along and wakes any waiter
+  swap_diskInterrupt();
+
+  TracePrintf(5, "EXIT trap_diskHandler\n");
 }
 
 /******************** trap_nullHandler ********************/
@@ -0,0 +1,246 @@
+/*
+ * file: workset.c
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  estimates which pages each process is using. the hardware
+ *  keeps no referenced bits, so every few ticks some pages are
+ *  dropped to PROT_NONE and the ones that fault back were used.
+ *  pages that keep not faulting age, giving a rough lru order
+ *  for paging out (see swap.c)
+ */
+
+#include <ykernel.h>
+#include "workset.h"
+#include "memory.h"
+#include "codes.h"
+#include "structs.h"
+#include "coordination.h"
+
+/***************** globals *****************/
+extern int currentClockTick;
+
+int wsRounds; //sampling rounds run
+int wsSampled; //pages dropped to PROT_NONE
+int wsFaults; //sampled pages touched before the next round
+
+/******************* local funcs *******************/
+int harvest(pcb_t* pcb);
+int sampleNext(pcb_t* pcb);
+void unsample(pcb_t* pcb, int page);
+
+/***************** ws_sample *****************/
+/*
+ * see workset.h for description
+ */
+void
+ws_sample()
+{
+  if (WS_SAMPLE_INTERVAL <= 0 || currentClockTick % WS_SAMPLE_INTERVAL != 0){
+    return;
+  }
+  TracePrintf(8, "ENTER ws_sample\n");
+  wsRounds++;
+
+  pcb_t* procs[MAX_PROCS];
+  int numProcs = coord_listProcesses(procs, MAX_PROCS);
+
+  for (int i = 0; i < numProcs; i++){
+    pcb_t* pcb = procs[i];
+    if (pcb->pt == NULL){
+      continue;
+    }
+
+    //giving pages back is always safe, taking them away isn't if the kernel
+    //is blocked in the middle of a call that already checked a buffer
+    int changed = harvest(pcb);
+    if (!pcb->pinned || coord_containsProcess(pcb, BLOCKEDDELAY) == 1){
+      changed += sampleNext(pcb);
+    }
+
+    //everyone else's tlb entries go when they're switched back in
+    if (changed > 0 && pcb == coord_getRunningProcess()){
+      WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
+    }
+  }
+
+  TracePrintf(8, "EXIT ws_sample\n");
+}
+
+/***************** ws_fault *****************/
+/*
+ * see workset.h for description
+ */
+int
+ws_fault(pcb_t* pcb, int page)
+{
+  if (page < 0 || page >= MAX_PT_LEN || (pcb->pageFlags[page] & PAGE_SAMPLED) == 0){
+    return 0;
+  }
+
+  //touched, so it's as young as it gets (and the swap clock hand should pass it by)
+  unsample(pcb, page);
+  pcb->pageAge[page] = 0;
+  pcb->pageFlags[page] |= PAGE_REF;
+  wsFaults++;
+  WriteRegister(REG_TLB_FLUSH, (page << PAGESHIFT) + VMEM_1_BASE);
+
+  TracePrintf(5, "ws_fault: process %d touched sampled page %d\n", pcb->pid, page);
+  return 1;
+}
+
+/***************** ws_restore *****************/
+/*
+ * see workset.h for description
+ */
+void
+ws_restore(pcb_t* pcb)
+{
+  int changed = 0;
+  for (int page = 0; page < MAX_PT_LEN; page++){
+    if (pcb->pageFlags[page] & PAGE_SAMPLED){
+      unsample(pcb, page);
+      changed++;
+    }
+  }
+
+  if (changed > 0 && pcb == coord_getRunningProcess()){
+    WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
+  }
+}
+
+/***************** ws_getProt *****************/
+/*
+ * see workset.h for description
+ */
+u_long
+ws_getProt(pcb_t* pcb, int page)
+{
+  if (pcb->pageFlags[page] & PAGE_SAMPLED){
+    return pcb->sampleProt[page];
+  }
+
+  return pcb->pt[page].prot;
+}
+
+/***************** ws_getStats *****************/
+/*
+ * see workset.h for description
+ */
+void
+ws_getStats(int* rounds, int* faults)
+{
+  *rounds = wsRounds;
+  *faults = wsFaults;
+}
+
+/***************** ws_exit *****************/
+/*
+ * see workset.h for description
+ */
+void
+ws_exit()
+{
+  TracePrintf(1, "working set: %d sampling rounds, %d pages sampled, %d touched (%d%%)\n",
+      wsRounds, wsSampled, wsFaults, wsSampled ? wsFaults * 100 / wsSampled : 0);
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** harvest ********************/
+/*
+ * age pages still sampled from last round (nobody touched
+ *  them), give them back their protection and recount the
+ *  process's working set
+ *
+ * input:
+ *  pcb - process to harvest
+ *
+ * output:
+ *  return number of ptes changed
+ *
+ */
+int
+harvest(pcb_t* pcb)
+{
+  int changed = 0;
+  int workingSet = 0;
+
+  for (int v = 0; v < pcb->numVmas; v++){
+    vma_t* vma = &(pcb->vmas[v]);
+    for (int page = vma->firstPage; page < vma->firstPage + vma->numPages; page++){
+      if (pcb->pageFlags[page] & PAGE_SAMPLED){
+        unsample(pcb, page);
+        if (pcb->pageAge[page] < WS_MAX_AGE){
+          pcb->pageAge[page]++;
+        }
+        changed++;
+      }
+
+      if (pcb->pt[page].valid && pcb->pageAge[page] < WS_COLD_AGE){
+        workingSet++;
+      }
+    }
+  }
+
+  pcb->workingSet = workingSet;
+  return changed;
+}
+
+/******************** sampleNext ********************/
+/*
+ * drop the next WS_SAMPLE_PAGES resident pages of a process
+ *  (from where the last round stopped) to PROT_NONE
+ *
+ * input:
+ *  pcb - process to sample
+ *
+ * output:
+ *  return number of pages sampled
+ *
+ */
+int
+sampleNext(pcb_t* pcb)
+{
+  int sampled = 0;
+  int page = pcb->sampleCursor;
+
+  for (int i = 0; i < MAX_PT_LEN && sampled < WS_SAMPLE_PAGES; i++){
+    page = (pcb->sampleCursor + i) % MAX_PT_LEN;
+
+    //shared segments are everyone's, and PROT_NONE pages have nothing to take away
+    if (pcb->pt[page].valid == 0 || pcb->pt[page].prot == PROT_NONE || (pcb->pageFlags[page] & PAGE_SHARED)){
+      continue;
+    }
+
+    pcb->sampleProt[page] = pcb->pt[page].prot;
+    pcb->pt[page].prot = PROT_NONE;
+    pcb->pageFlags[page] |= PAGE_SAMPLED;
+    sampled++;
+  }
+
+  pcb->sampleCursor = (page + 1) % MAX_PT_LEN;
+  wsSampled += sampled;
+  return sampled;
+}
+
+/******************** unsample ********************/
+/*
+ * put a sampled page's protection back
+ *
+ * input:
+ *  pcb - process owning the page
+ *  page - sampled page
+ *
+ * output:
+ *  none
+ *
+ */
+void
+unsample(pcb_t* pcb, int page)
+{
+  pcb->pt[page].prot = pcb->sampleProt[page];
+  pcb->pageFlags[page] &= ~PAGE_SAMPLED;
+}
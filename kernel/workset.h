@@ -0,0 +1,136 @@
+/*
+ * file: workset.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  interface for workset.c (working set estimates by sampling)
+ */
+
+#ifndef WORKSET_H
+#define WORKSET_H
+
+#include <ykernel.h>
+#include "codes.h"
+#include "structs.h"
+
+/********************* ws_sample *********************/
+/*
+ * every WS_SAMPLE_INTERVAL ticks, age the pages sampled last
+ *  round that were never touched, update each process's
+ *  working set estimate, then drop the next few pages of
+ *  each process to PROT_NONE
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ * notes:
+ *  called every clock tick. pinned processes (other than
+ *   ones in Delay) only get their pages back, never sampled
+ *
+ */
+
+//-------------------------------------------------------
+
+void ws_sample();
+
+//-------------------------------------------------------
+
+/********************* ws_fault *********************/
+/*
+ * give a sampled page its protection back, it was touched
+ *
+ * input: 
+ *  pcb - running process
+ *  page - region 1 page
+ *
+ * output:
+ *  return 1 if page was being sampled (fault is handled)
+ *  return 0 if not
+ *
+ */
+
+//-------------------------------------------------------
+
+int ws_fault(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/********************* ws_restore *********************/
+/*
+ * give every sampled page of a process its protection back
+ *  without counting it as touched (before copying its ptes)
+ *
+ * input: 
+ *  pcb - process to restore
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void ws_restore(pcb_t* pcb);
+
+//-------------------------------------------------------
+
+/********************* ws_getProt *********************/
+/*
+ * real protection of a page, sampled or not
+ *
+ * input: 
+ *  pcb - process owning the page
+ *  page - region 1 page
+ *
+ * output:
+ *  return protection the page has when not being sampled
+ *
+ */
+
+//-------------------------------------------------------
+
+u_long ws_getProt(pcb_t* pcb, int page);
+
+//-------------------------------------------------------
+
+/********************* ws_getStats *********************/
+/*
+ * get sampling stats
+ *
+ * input: 
+ *  rounds - set to sampling rounds run
+ *  faults - set to sampled pages that were touched
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void ws_getStats(int* rounds, int* faults);
+
+//-------------------------------------------------------
+
+/********************* ws_exit *********************/
+/*
+ * report sampling stats on the way down
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void ws_exit();
+
+//-------------------------------------------------------
+
+#endif
@@ -0,0 +1,465 @@
+/*
+ * file: zcache.c
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  keeps paged out pages compressed in a few frames of memory,
+ *  so pages that shrink well never have to go to the disk.
+ *  pages are compressed with a small lz77 style coder
+ */
+
+#include <ykernel.h>
+#include "zcache.h"
+#include "memory.h"
+#include "codes.h"
+#include "structs.h"
+
+#define LZ_MIN_MATCH 3 //shortest match worth a 3 byte token
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH) //longest match one token holds
+#define LZ_MAX_LITERALS 0x80 //longest literal run one token holds
+#define LZ_HASH_BITS 12
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)
+
+/***************** globals *****************/
+zcacheEntry_t entries[ZCACHE_ENTRIES];
+int freeEntries[ZCACHE_ENTRIES]; //stack of unused entries
+int freeEntryCount;
+int storeFrames[ZCACHE_FRAMES]; //frames the store holds (ERROR if slot empty)
+unsigned int storeChunks[ZCACHE_FRAMES]; //bit per chunk in use in each store frame
+int storeFrameCount;
+int storedPages; //pages in the store now
+int storedBytes; //compressed bytes those pages take
+short lzTable[LZ_HASH_SIZE]; //last page offset each 3 byte hash was seen at
+unsigned char lzBuffer[ZCACHE_MAX_CHUNKS * ZCACHE_CHUNK]; //compressed page on its way into the store
+int zcacheStores; //pages compressed into the store
+int zcacheRejects; //pages that didn't compress well enough
+int zcacheLoads; //pages decompressed back out
+long zcacheBytesIn; //uncompressed bytes of every page stored
+long zcacheBytesOut; //compressed bytes of every page stored
+
+/******************* local funcs *******************/
+int findChunks(int numChunks, int* firstChunk);
+int lzCompress(unsigned char* src, unsigned char* dst, int max);
+int lzDecompress(unsigned char* src, int size, unsigned char* dst);
+int putLiterals(unsigned char* src, int count, unsigned char* dst, int out, int max);
+
+/***************** zcache_init *****************/
+/*
+ * see zcache.h for description
+ */
+void
+zcache_init()
+{
+  TracePrintf(5, "ENTER zcache_init\n");
+
+  for (int entry = 0; entry < ZCACHE_ENTRIES; entry++){
+    entries[entry].store = ERROR;
+    entries[entry].refs = 0;
+    freeEntries[entry] = ZCACHE_ENTRIES - 1 - entry;
+  }
+  freeEntryCount = ZCACHE_ENTRIES;
+
+  for (int store = 0; store < ZCACHE_FRAMES; store++){
+    storeFrames[store] = ERROR;
+    storeChunks[store] = 0;
+  }
+  storeFrameCount = 0;
+
+  TracePrintf(1, "zcache: up to %d frames of %d byte chunks\n", ZCACHE_FRAMES, ZCACHE_CHUNK);
+  TracePrintf(5, "EXIT zcache_init\n");
+}
+
+/***************** zcache_exit *****************/
+/*
+ * see zcache.h for description
+ */
+void
+zcache_exit()
+{
+  TracePrintf(1, "zcache: %d pages stored, %d too big to store, %d loaded back, %d left\n",
+      zcacheStores, zcacheRejects, zcacheLoads, storedPages);
+  TracePrintf(1, "zcache: pages compressed to %d%% of their size on average\n",
+      zcacheBytesIn ? (int)(zcacheBytesOut * 100 / zcacheBytesIn) : 0);
+
+  //every process is gone, so nothing should be left, but don't lose the frames if it is
+  for (int store = 0; store < ZCACHE_FRAMES; store++){
+    if (storeFrames[store] != ERROR){
+      mem_freeFrame(storeFrames[store]);
+      storeFrames[store] = ERROR;
+      storeFrameCount--;
+    }
+  }
+}
+
+/***************** zcache_hasRoom *****************/
+/*
+ * see zcache.h for description
+ */
+int
+zcache_hasRoom()
+{
+  if (freeEntryCount == 0){
+    return 0;
+  }
+
+  //a new store frame fits in the budget
+  if (storeFrameCount < ZCACHE_FRAMES){
+    return 1;
+  }
+
+  //or the smallest page fits in a frame already held
+  int firstChunk;
+  return findChunks(1, &firstChunk) != ERROR;
+}
+
+/***************** zcache_store *****************/
+/*
+ * see zcache.h for description
+ */
+int
+zcache_store(int frame)
+{
+  TracePrintf(5, "ENTER zcache_store (frame %d)\n", frame);
+
+  if (freeEntryCount == 0){
+    TracePrintf(5, "EXIT zcache_store (no free entries)\n");
+    return ERROR;
+  }
+
+  //compress, giving up once it's past the biggest size worth keeping
+  unsigned char* page = mem_mapWindow(&frame, 1);
+  int size = lzCompress(page, lzBuffer, sizeof(lzBuffer));
+  mem_unmapWindow(1);
+  if (size == ERROR){
+    zcacheRejects++;
+    TracePrintf(5, "EXIT zcache_store (doesn't compress)\n");
+    return ERROR;
+  }
+
+  //find a run of chunks, taking another store frame if none has one
+  int numChunks = (size + ZCACHE_CHUNK - 1) / ZCACHE_CHUNK;
+  int firstChunk;
+  int store = findChunks(numChunks, &firstChunk);
+  if (store == ERROR){
+    for (store = 0; store < ZCACHE_FRAMES && storeFrames[store] != ERROR; store++);
+    if (store == ZCACHE_FRAMES){
+      TracePrintf(5, "EXIT zcache_store (store full)\n");
+      return ERROR;
+    }
+
+    //never make room for the store, it's what makes room
+    storeFrameCount++;
+    storeFrames[store] = mem_getFreeFrame();
+    if (storeFrames[store] == ERROR){
+      storeFrameCount--;
+      TracePrintf(5, "EXIT zcache_store (no frame for store)\n");
+      return ERROR;
+    }
+    storeChunks[store] = 0;
+    firstChunk = 0;
+  }
+
+  //copy the compressed page into its chunks
+  unsigned char* dst = mem_mapWindow(&storeFrames[store], 1);
+  memcpy(dst + firstChunk * ZCACHE_CHUNK, lzBuffer, size);
+  mem_unmapWindow(1);
+  storeChunks[store] |= ((1u << numChunks) - 1) << firstChunk;
+
+  int entry = freeEntries[--freeEntryCount];
+  entries[entry].store = store;
+  entries[entry].firstChunk = firstChunk;
+  entries[entry].numChunks = numChunks;
+  entries[entry].size = size;
+  entries[entry].refs = 1;
+
+  storedPages++;
+  storedBytes += size;
+  zcacheStores++;
+  zcacheBytesIn += PAGESIZE;
+  zcacheBytesOut += size;
+
+  TracePrintf(5, "EXIT zcache_store (entry %d, %d bytes)\n", entry, size);
+  return entry;
+}
+
+/***************** zcache_load *****************/
+/*
+ * see zcache.h for description
+ */
+int
+zcache_load(int entry, int frame)
+{
+  TracePrintf(5, "ENTER zcache_load (entry %d)\n", entry);
+
+  if (entry < 0 || entry >= ZCACHE_ENTRIES || entries[entry].store == ERROR){
+    TracePrintf(1, "zcache_load: entry %d not in use\n", entry);
+    return ERROR;
+  }
+
+  //store frame and destination side by side, decompress straight across
+  zcacheEntry_t* e = &entries[entry];
+  int pair[2] = {storeFrames[e->store], frame};
+  unsigned char* window = mem_mapWindow(pair, 2);
+  int rc = lzDecompress(window + e->firstChunk * ZCACHE_CHUNK, e->size, window + PAGESIZE);
+  mem_unmapWindow(2);
+
+  if (rc == ERROR){
+    TracePrintf(0, "zcache_load: entry %d is corrupt\n", entry);
+    return ERROR;
+  }
+  zcacheLoads++;
+
+  TracePrintf(5, "EXIT zcache_load\n");
+  return 0;
+}
+
+/***************** zcache_share *****************/
+/*
+ * see zcache.h for description
+ */
+void
+zcache_share(int entry)
+{
+  entries[entry].refs++;
+}
+
+/***************** zcache_drop *****************/
+/*
+ * see zcache.h for description
+ */
+void
+zcache_drop(int entry)
+{
+  zcacheEntry_t* e = &entries[entry];
+  if (e->store == ERROR || --e->refs > 0){
+    return;
+  }
+
+  //give the chunks back, and the store frame with its last page
+  int store = e->store;
+  storeChunks[store] &= ~(((1u << e->numChunks) - 1) << e->firstChunk);
+  if (storeChunks[store] == 0){
+    mem_freeFrame(storeFrames[store]);
+    storeFrames[store] = ERROR;
+    storeFrameCount--;
+  }
+
+  storedPages--;
+  storedBytes -= e->size;
+  e->store = ERROR;
+  freeEntries[freeEntryCount++] = entry;
+}
+
+/***************** zcache_getStats *****************/
+/*
+ * see zcache.h for description
+ */
+void
+zcache_getStats(int* frames, int* pages, int* bytes)
+{
+  *frames = storeFrameCount;
+  *pages = storedPages;
+  *bytes = storedBytes;
+}
+
+/***************** zcache_getTotals *****************/
+/*
+ * see zcache.h for description
+ */
+void
+zcache_getTotals(int* stores, int* loads)
+{
+  *stores = zcacheStores;
+  *loads = zcacheLoads;
+}
+
+//--------------------------------------------------------
+/****************** local functions  ********************/
+//--------------------------------------------------------
+
+/******************** findChunks ********************/
+/*
+ * find a run of free chunks in a store frame already held
+ *
+ * input:
+ *  numChunks - chunks needed (at most ZCACHE_MAX_CHUNKS)
+ *  firstChunk - set to first chunk of the run
+ *
+ * output:
+ *  return store frame index
+ *  return ERROR if no held frame has the room
+ *
+ */
+int
+findChunks(int numChunks, int* firstChunk)
+{
+  unsigned int run = (1u << numChunks) - 1;
+
+  for (int store = 0; store < ZCACHE_FRAMES; store++){
+    if (storeFrames[store] == ERROR){
+      continue;
+    }
+
+    for (int chunk = 0; chunk + numChunks <= ZCACHE_CHUNKS_PER_FRAME; chunk++){
+      if ((storeChunks[store] & (run << chunk)) == 0){
+        *firstChunk = chunk;
+        return store;
+      }
+    }
+  }
+
+  return ERROR;
+}
+
+/******************** lzCompress ********************/
+/*
+ * compress a page. output is a list of tokens: a byte
+ *  under 0x80 is a run of that many plus one literal bytes
+ *  that follow it, anything else is a match of
+ *  (byte & 0x7f) + LZ_MIN_MATCH bytes copied from an offset
+ *  back in the page given by the next two bytes (low first)
+ *
+ * input:
+ *  src - page to compress
+ *  dst - buffer for the compressed page
+ *  max - size of dst
+ *
+ * output:
+ *  return compressed size
+ *  return ERROR if it doesn't fit in max
+ *
+ */
+int
+lzCompress(unsigned char* src, unsigned char* dst, int max)
+{
+  for (int i = 0; i < LZ_HASH_SIZE; i++){
+    lzTable[i] = -1;
+  }
+
+  int in = 0;
+  int out = 0;
+  int literals = 0; //start of literals not written out yet
+
+  while (in + LZ_MIN_MATCH <= PAGESIZE){
+    unsigned int key = (src[in] << 16) | (src[in + 1] << 8) | src[in + 2];
+    unsigned int hash = (key * 2654435761u) >> (32 - LZ_HASH_BITS);
+    int candidate = lzTable[hash];
+    lzTable[hash] = in;
+
+    //how far the last spot with this hash matches (may run into the bytes being matched)
+    int len = 0;
+    if (candidate >= 0){
+      while (len < LZ_MAX_MATCH && in + len < PAGESIZE && src[candidate + len] == src[in + len]){
+        len++;
+      }
+    }
+
+    if (len < LZ_MIN_MATCH){
+      in++;
+      continue;
+    }
+
+    out = putLiterals(src + literals, in - literals, dst, out, max);
+    if (out == ERROR || out + 3 > max){
+      return ERROR;
+    }
+
+    int offset = in - candidate;
+    dst[out++] = 0x80 | (len - LZ_MIN_MATCH);
+    dst[out++] = offset & 0xff;
+    dst[out++] = offset >> 8;
+    in += len;
+    literals = in;
+  }
+
+  return putLiterals(src + literals, PAGESIZE - literals, dst, out, max);
+}
+
+/******************** putLiterals ********************/
+/*
+ * write literal runs for bytes no match covered
+ *
+ * input:
+ *  src - first literal byte
+ *  count - number of literal bytes
+ *  dst - compressed output
+ *  out - where in dst to write
+ *  max - size of dst
+ *
+ * output:
+ *  return where in dst the next token goes
+ *  return ERROR if they don't fit
+ *
+ */
+int
+putLiterals(unsigned char* src, int count, unsigned char* dst, int out, int max)
+{
+  while (count > 0){
+    int run = (count < LZ_MAX_LITERALS) ? count : LZ_MAX_LITERALS;
+    if (out + 1 + run > max){
+      return ERROR;
+    }
+
+    dst[out++] = run - 1;
+    memcpy(dst + out, src, run);
+    out += run;
+    src += run;
+    count -= run;
+  }
+
+  return out;
+}
+
+/******************** lzDecompress ********************/
+/*
+ * undo lzCompress (see it for the format)
+ *
+ * input:
+ *  src - compressed page
+ *  size - compressed bytes
+ *  dst - page to fill
+ *
+ * output:
+ *  return 0 if exactly a page came out
+ *  return ERROR if src is malformed
+ *
+ */
+int
+lzDecompress(unsigned char* src, int size, unsigned char* dst)
+{
+  int in = 0;
+  int out = 0;
+
+  while (in < size){
+    int token = src[in++];
+
+    if (token < 0x80){
+      int run = token + 1;
+      if (in + run > size || out + run > PAGESIZE){
+        return ERROR;
+      }
+      memcpy(dst + out, src + in, run);
+      in += run;
+      out += run;
+      continue;
+    }
+
+    if (in + 2 > size){
+      return ERROR;
+    }
+    int len = (token & 0x7f) + LZ_MIN_MATCH;
+    int offset = src[in] | (src[in + 1] << 8);
+    in += 2;
+    if (offset == 0 || offset > out || out + len > PAGESIZE){
+      return ERROR;
+    }
+
+    //byte at a time, matches can overlap what they're producing
+    for (int i = 0; i < len; i++){
+      dst[out] = dst[out - offset];
+      out++;
+    }
+  }
+
+  return (out == PAGESIZE) ? 0 : ERROR;
+}
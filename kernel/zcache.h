@@ -0,0 +1,195 @@
+/*
+ * file: zcache.h
+ * Mutex Locked_In, CS58, W25
+ *
+ * description:
+ *  interface for zcache.c (compressed in memory page store)
+ */
+
+#ifndef ZCACHE_H
+#define ZCACHE_H
+
+#include <ykernel.h>
+#include "codes.h"
+#include "structs.h"
+
+/********************* zcache_init *********************/
+/*
+ * start with an empty store (no frames held)
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void zcache_init();
+
+//-------------------------------------------------------
+
+/********************* zcache_exit *********************/
+/*
+ * report store stats and give back any frames still held
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void zcache_exit();
+
+//-------------------------------------------------------
+
+/********************* zcache_hasRoom *********************/
+/*
+ * whether the store could take another page, so callers
+ *  don't pick a victim for nothing
+ *
+ * input: 
+ *  none
+ *
+ * output:
+ *  return 1 if there's a free entry and either a chunk run
+ *   free or a frame left in the budget
+ *  return 0 if not
+ *
+ */
+
+//-------------------------------------------------------
+
+int zcache_hasRoom();
+
+//-------------------------------------------------------
+
+/********************* zcache_store *********************/
+/*
+ * compress a frame into the store
+ *
+ * input: 
+ *  frame - frame holding the page (left as is)
+ *
+ * output:
+ *  return entry holding the page (one ref)
+ *  return ERROR if the page doesn't compress well enough
+ *   or there's no room
+ *
+ * notes:
+ *  never blocks, so it's fine to call off of idle
+ *
+ */
+
+//-------------------------------------------------------
+
+int zcache_store(int frame);
+
+//-------------------------------------------------------
+
+/********************* zcache_load *********************/
+/*
+ * decompress an entry into a frame
+ *
+ * input: 
+ *  entry - entry to read
+ *  frame - frame to fill
+ *
+ * output:
+ *  return 0 on success
+ *  return ERROR if the entry is unused or corrupt
+ *
+ * notes:
+ *  the entry keeps its refs, zcache_drop it after
+ *
+ */
+
+//-------------------------------------------------------
+
+int zcache_load(int entry, int frame);
+
+//-------------------------------------------------------
+
+/********************* zcache_share *********************/
+/*
+ * another pte now points at an entry (fork)
+ *
+ * input: 
+ *  entry - entry being shared
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void zcache_share(int entry);
+
+//-------------------------------------------------------
+
+/********************* zcache_drop *********************/
+/*
+ * a pte lets go of an entry, freeing its chunks (and the
+ *  store frame if it empties) with the last ref
+ *
+ * input: 
+ *  entry - entry to drop
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void zcache_drop(int entry);
+
+//-------------------------------------------------------
+
+/********************* zcache_getStats *********************/
+/*
+ * get compressed store stats
+ *
+ * input: 
+ *  frames - set to store frames held now
+ *  pages - set to pages in the store now
+ *  bytes - set to compressed bytes those pages take
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void zcache_getStats(int* frames, int* pages, int* bytes);
+
+//-------------------------------------------------------
+
+/********************* zcache_getTotals *********************/
+/*
+ * get how many pages have gone through the store since boot
+ *
+ * input: 
+ *  stores - set to pages compressed into the store
+ *  loads - set to pages decompressed back out
+ *
+ * output:
+ *  none
+ *
+ */
+
+//-------------------------------------------------------
+
+void zcache_getTotals(int* stores, int* loads);
+
+//-------------------------------------------------------
+
+#endif
@@ -0,0 +1,75 @@
+#include "yuser.h"
+#include "ylib.h"
+#include "kernel/memstats.h"
+
+#define CHILDREN 3
+#define PAGES 8
+#define PAGE 0x2000
+
+//children fill heap pages with the same pattern and sleep so
+//the idle scanner can merge them, then each writes its own
+//pattern over the shared pages and checks nobody else's leaked in
+int main(void){
+  int before[MEMSTAT_COUNT];
+  int after[MEMSTAT_COUNT];
+  Custom1((int)before, MEMSTAT_COUNT, 0, 0);
+
+  for (int i = 0; i < CHILDREN; i++){
+    if (Fork() == 0){
+      int me = GetPid();
+      char* buf = malloc(PAGES * PAGE);
+      if (buf == NULL){
+        TracePrintf(0, "[TEST] child %d: malloc failed\n", me);
+        Exit(-1);
+      }
+
+      //same contents in every child (last page dirtied then zeroed again)
+      for (int j = 0; j < PAGES * PAGE; j++){
+        buf[j] = (char)(j / PAGE + 1);
+      }
+      memset(buf + (PAGES - 1) * PAGE, 0, PAGE);
+
+      //idle gets the cpu while everyone sleeps
+      Delay(20);
+
+      //break the sharing, then make sure only our writes show up
+      for (int j = 0; j < PAGES * PAGE; j += 2){
+        buf[j] = (char)me;
+      }
+      Delay(2);
+
+      int bad = 0;
+      for (int j = 0; j < PAGES * PAGE; j++){
+        char want = (j % 2 == 0) ? (char)me : (j >= (PAGES - 1) * PAGE ? 0 : (char)(j / PAGE + 1));
+        if (buf[j] != want){
+          bad++;
+        }
+      }
+      TracePrintf(0, "[TEST] child %d: %d bad bytes\n", me, bad);
+      Exit(bad);
+    }
+  }
+
+  Delay(15);
+  Custom1((int)after, MEMSTAT_COUNT, 0, 0);
+  TracePrintf(0, "[TEST] dedup scanned %d pages, merged %d, saved %d frames\n",
+      after[MEMSTAT_DEDUP_SCANNED] - before[MEMSTAT_DEDUP_SCANNED],
+      after[MEMSTAT_DEDUP_MERGED] - before[MEMSTAT_DEDUP_MERGED],
+      after[MEMSTAT_DEDUP_SAVED] - before[MEMSTAT_DEDUP_SAVED]);
+
+  int failed = (after[MEMSTAT_DEDUP_MERGED] == before[MEMSTAT_DEDUP_MERGED]);
+  int status;
+  for (int i = 0; i < CHILDREN; i++){
+    Wait(&status);
+    if (status != 0){
+      failed = 1;
+    }
+  }
+
+  if (failed){
+    TracePrintf(0, "[TEST] FAIL: dedup\n");
+  } else {
+    TracePrintf(0, "[TEST] PASS: dedup\n");
+  }
+  Exit(0);
+}
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <yuser.h>
 #include "ykernel.h"
+#include "kernel/clockstats.h"
 
 /*
  * delay_test.c
@@ -14,11 +15,21 @@
  *   TEST 3: Call Delay with a positive value (10 ticks) and measure elapsed ticks.
  *   TEST 4: Fork a child process that delays 5 ticks while the parent delays 8 ticks.
  *           Then, the parent waits for the child to exit.
+ *   TEST 5: Delays that go through level 1 of the timer wheel and end on, just
+ *           before and just after a 64 tick lap, checking (via Custom2) each
+ *           wakes on exactly the tick it asked for.
  *
  * The program prints messages via TracePrintf so that you can follow its progress in the trace file.
  */
 
 
+//clock tick right now
+int now(void) {
+  int stats[CLOCKSTAT_COUNT];
+  Custom2((int)stats, CLOCKSTAT_COUNT, 0, 0);
+  return stats[CLOCKSTAT_TICK];
+}
+
 int main(void) {
   int ret, start, end;
 
@@ -62,6 +73,32 @@ int main(void) {
     TracePrintf(0, "TEST 4 FAILED: Fork failed.\n");
   }
 
+  // TEST 5: Exact wake ticks around a timer wheel lap (64 ticks).
+  TracePrintf(0, "TEST 5: Wake ticks around the 64 tick boundary\n");
+  int late = 0;
+  int offsets[] = {-1, 0, 1};
+  for (int lap = 1; lap <= 2; lap++) {
+    for (int i = 0; i < 3; i++) {
+      //start right at the top of a tick, so the clock can't move before Delay traps
+      Delay(1);
+      start = now();
+
+      //ends lap + 1 laps ahead, so it starts out on level 1 and has to move down
+      int delay = (64 - start % 64) + 64 * lap + offsets[i];
+      Delay(delay);
+      end = now();
+      if (end != start + delay) {
+        TracePrintf(0, "TEST 5: Delay(%d) from tick %d woke on %d, expected %d\n", delay, start, end, start + delay);
+        late++;
+      }
+    }
+  }
+  if (late == 0) {
+    TracePrintf(0, "TEST 5 PASSED: every delay woke on its tick.\n");
+  } else {
+    TracePrintf(0, "TEST 5 FAILED: %d delays woke off their tick.\n", late);
+  }
+
   TracePrintf(0, "------------------ DELAY TEST END ------------------\n");
   return 0;
 }
\ No newline at end of file
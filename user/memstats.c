@@ -0,0 +1,91 @@
+#include "yuser.h"
+#include "ylib.h"
+#include "kernel/memstats.h"
+
+#define CHILDREN 4
+#define BYTES (64 * 1024)
+
+//print a snapshot and check the categories add up to the total
+int report(char* when, int* stats){
+  int n = Custom1((int)stats, MEMSTAT_COUNT, 0, 0);
+  if (n != MEMSTAT_COUNT){
+    TracePrintf(0, "[TEST] %s: Custom1 gave %d stats, wanted %d\n", when, n, MEMSTAT_COUNT);
+    return -1;
+  }
+
+  TracePrintf(0, "[TEST] %s: %d free of %d (low %d), %d free runs (largest %d)\n", when,
+      stats[MEMSTAT_FREE], stats[MEMSTAT_TOTAL], stats[MEMSTAT_FREE_LOW],
+      stats[MEMSTAT_FREE_RUNS], stats[MEMSTAT_LARGEST_RUN]);
+  TracePrintf(0, "[TEST] %s: kheap %d, kstacks %d, user %d (peak %d), page tables %d, cached %d\n", when,
+      stats[MEMSTAT_KHEAP], stats[MEMSTAT_KSTACK], stats[MEMSTAT_USER], stats[MEMSTAT_USER_PEAK],
+      stats[MEMSTAT_PTABLE], stats[MEMSTAT_CACHED]);
+
+  int sum = stats[MEMSTAT_FREE] + stats[MEMSTAT_KHEAP] + stats[MEMSTAT_KSTACK]
+      + stats[MEMSTAT_USER] + stats[MEMSTAT_CACHED];
+  if (sum != stats[MEMSTAT_TOTAL]){
+    TracePrintf(0, "[TEST] %s: categories add to %d, not %d\n", when, sum, stats[MEMSTAT_TOTAL]);
+    return -1;
+  }
+  return 0;
+}
+
+//children grab heap while the parent watches the stats move,
+//then everything should come back once they are waited on
+int main(void){
+  int before[MEMSTAT_COUNT];
+  int during[MEMSTAT_COUNT];
+  int after[MEMSTAT_COUNT];
+
+  if (report("before", before) != 0){
+    Exit(-1);
+  }
+
+  //bad buffers are refused
+  if (Custom1((int)NULL, MEMSTAT_COUNT, 0, 0) != ERROR){
+    TracePrintf(0, "[TEST] FAIL: NULL buffer accepted\n");
+  }
+  if (Custom1((int)before, -1, 0, 0) != ERROR){
+    TracePrintf(0, "[TEST] FAIL: negative count accepted\n");
+  }
+
+  //asking for fewer stats only fills that many
+  int two[2];
+  if (Custom1((int)two, 2, 0, 0) != 2 || two[MEMSTAT_TOTAL] != before[MEMSTAT_TOTAL]){
+    TracePrintf(0, "[TEST] FAIL: short buffer\n");
+  }
+
+  for (int i = 0; i < CHILDREN; i++){
+    if (Fork() == 0){
+      char* buf = malloc(BYTES);
+      for (int j = 0; buf != NULL && j < BYTES; j++){
+        buf[j] = (char)j;
+      }
+      Delay(3);
+      Exit(0);
+    }
+  }
+
+  Delay(1);
+  report("children running", during);
+  if (during[MEMSTAT_PTABLE] < before[MEMSTAT_PTABLE] + CHILDREN){
+    TracePrintf(0, "[TEST] FAIL: %d page tables with %d children\n", during[MEMSTAT_PTABLE], CHILDREN);
+  }
+
+  int status;
+  for (int i = 0; i < CHILDREN; i++){
+    Wait(&status);
+  }
+
+  //give the clock a few ticks to free the dead children
+  Delay(3);
+  report("after", after);
+  if (after[MEMSTAT_PTABLE] != before[MEMSTAT_PTABLE] || after[MEMSTAT_KSTACK] != before[MEMSTAT_KSTACK]){
+    TracePrintf(0, "[TEST] FAIL: children's page tables or kernel stacks still held\n");
+  } else if (after[MEMSTAT_USER_PEAK] <= before[MEMSTAT_USER]){
+    TracePrintf(0, "[TEST] FAIL: user peak never moved\n");
+  } else {
+    TracePrintf(0, "[TEST] PASS: memory stats\n");
+  }
+
+  Exit(0);
+}
@@ -0,0 +1,199 @@
+#include "yuser.h"
+#include "ylib.h"
+#include "yalnix.h"
+#include "kernel/clockstats.h"
+
+#define SPINNERS 2
+#define ROUNDS 10
+#define TTY 1
+#define POLICY_MLFQ 2 //CLOCKSTAT_POLICY under mlfq
+#define BOOST_WAIT 300 //most ticks to wait for a boost (several boost intervals)
+
+struct shared {
+  volatile int stop;
+  volatile int spins[SPINNERS];
+  volatile int lowest[SPINNERS]; //lowest level (highest number) each spinner got to
+  volatile int reboosted; //a demoted spinner was seen back at level 0
+  volatile int sunk; //levels the writer had sunk to before blocking on the pipe
+  volatile int promoted; //times blocking on the pipe moved it up
+  volatile int printPromoted; //times writing to the terminal moved it up (shouldn't)
+  volatile int filled; //rounds the writer has filled the pipe for
+  volatile int lines;
+};
+
+//one stat from Custom2
+int clockStat(int which){
+  int stats[CLOCKSTAT_COUNT];
+  Custom2((int)stats, CLOCKSTAT_COUNT, 0, 0);
+  return stats[which];
+}
+
+int totalSpins(struct shared* s){
+  int total = 0;
+  for (int i = 0; i < SPINNERS; i++){
+    total += s->spins[i];
+  }
+  return total;
+}
+
+//burn cpu til the scheduler has moved us off level 0 (mlfq only)
+void sink(int mlfq){
+  int level = 0;
+  for (int j = 0; mlfq && level == 0 && j < 100000000; j++){
+    if (j % 10000 == 0){
+      level = clockStat(CLOCKSTAT_LEVEL);
+    }
+  }
+}
+
+//cpu bound children spin while an interactive one writes to a
+//terminal and waits on a pipe the parent drains. under mlfq the
+//spinners should sink (demotion), the writer should come back up
+//each time it waits on the pipe (promotion) but not for writing
+//to the terminal, and the spinners should be pulled back to level
+//0 now and then (boost); under round robin everyone stays at
+//level 0. run with sched=rr and sched=mlfq to compare spins per
+//line too
+int main(int argc, char** argv){
+  struct shared* s = (struct shared*)Shared_Pages(1);
+  int pipe;
+  if ((int)s == ERROR || PipeInit(&pipe) == ERROR){
+    TracePrintf(0, "[TEST] FAIL: mlfq (Shared_Pages or PipeInit failed)\n");
+    Exit(-1);
+  }
+  int mlfq = (clockStat(CLOCKSTAT_POLICY) == POLICY_MLFQ);
+
+  for (int i = 0; i < SPINNERS; i++){
+    if (Fork() == 0){
+      while (!s->stop){
+        s->spins[i]++;
+
+        //check where the scheduler has us now and then
+        if (s->spins[i] % 10000 == 0){
+          int level = clockStat(CLOCKSTAT_LEVEL);
+          if (level > s->lowest[i]){
+            s->lowest[i] = level;
+          }
+          if (level == 0 && s->lowest[i] > 0){
+            s->reboosted = 1;
+          }
+        }
+      }
+      Exit(0);
+    }
+  }
+
+  if (Fork() == 0){
+    char fill[PIPE_BUFFER_LEN];
+    memset(fill, 'x', PIPE_BUFFER_LEN);
+
+    int start = totalSpins(s);
+    int worst = 0;
+    for (int r = 0; r < ROUNDS; r++){
+      //burn a slice or two so there's a level to be promoted from
+      sink(mlfq);
+
+      //terminal output is just a device wait, it shouldn't move us up
+      int level = clockStat(CLOCKSTAT_LEVEL);
+      int before = totalSpins(s);
+      TtyPrintf(TTY, "mlfq: line %d (level %d)\n", r, level);
+      s->lines++;
+      int waited = totalSpins(s) - before;
+      if (waited > worst){
+        worst = waited;
+      }
+      if (clockStat(CLOCKSTAT_LEVEL) < level){
+        s->printPromoted++;
+      }
+
+      //fill the pipe, then one more byte has to wait for the parent to drain it
+      PipeWrite(pipe, fill, PIPE_BUFFER_LEN);
+      level = clockStat(CLOCKSTAT_LEVEL);
+      s->sunk += level;
+      s->filled++;
+      PipeWrite(pipe, fill, 1);
+      if (clockStat(CLOCKSTAT_LEVEL) < level){
+        s->promoted++;
+      }
+    }
+    TracePrintf(0, "[TEST] %d lines written, %d spins per line on average, %d at worst\n",
+        ROUNDS, (totalSpins(s) - start) / ROUNDS, worst);
+
+    //give the spinners a chance to be boosted back up
+    for (int t = 0; mlfq && !s->reboosted && t < BOOST_WAIT; t++){
+      Delay(1);
+    }
+
+    s->stop = 1;
+    Exit(0);
+  }
+
+  //drain the pipe once the writer is stuck on it each round
+  char drain[PIPE_BUFFER_LEN];
+  for (int r = 0; r < ROUNDS; r++){
+    while (s->filled <= r){
+      Delay(1);
+    }
+    Delay(1);
+    PipeRead(pipe, drain, PIPE_BUFFER_LEN);
+    PipeRead(pipe, drain, 1);
+  }
+
+  for (int i = 0; i < SPINNERS + 1; i++){
+    Wait(NULL);
+  }
+
+  int stats[CLOCKSTAT_COUNT];
+  Custom2((int)stats, CLOCKSTAT_COUNT, 0, 0);
+  TracePrintf(0, "[TEST] %s: spinners sank to levels %d and %d, writer promoted %d of %d times on the pipe "
+      "(%d on the terminal), %d demotions, %d promotions, %d boosts\n", mlfq ? "mlfq" : "round robin",
+      s->lowest[0], s->lowest[1], s->promoted, ROUNDS, s->printPromoted,
+      stats[CLOCKSTAT_DEMOTIONS], stats[CLOCKSTAT_PROMOTIONS], stats[CLOCKSTAT_BOOSTS]);
+
+  int fail = 0;
+  for (int i = 0; i < SPINNERS; i++){
+    if (s->spins[i] == 0){
+      TracePrintf(0, "[TEST] spinner %d never ran\n", i);
+      fail++;
+    }
+  }
+  if (s->lines != ROUNDS){
+    TracePrintf(0, "[TEST] writer only wrote %d lines\n", s->lines);
+    fail++;
+  }
+
+  if (mlfq){
+    //spinners use their whole slices, so they have to sink
+    if (s->lowest[0] == 0 || s->lowest[1] == 0 || stats[CLOCKSTAT_DEMOTIONS] == 0){
+      TracePrintf(0, "[TEST] spinners were never demoted\n");
+      fail++;
+    }
+    //waiting on the pipe moves the writer up, writing to the terminal doesn't
+    if (s->sunk == 0 || s->promoted == 0 || stats[CLOCKSTAT_PROMOTIONS] == 0){
+      TracePrintf(0, "[TEST] writer wasn't promoted for waiting on the pipe\n");
+      fail++;
+    }
+    if (s->printPromoted != 0){
+      TracePrintf(0, "[TEST] writer was promoted for writing to the terminal\n");
+      fail++;
+    }
+    //and nobody stays sunk forever
+    if (!s->reboosted || stats[CLOCKSTAT_BOOSTS] == 0){
+      TracePrintf(0, "[TEST] demoted spinners were never boosted back up\n");
+      fail++;
+    }
+  } else {
+    //round robin has one level
+    if (s->lowest[0] != 0 || s->lowest[1] != 0 || s->sunk != 0 || stats[CLOCKSTAT_DEMOTIONS] != 0){
+      TracePrintf(0, "[TEST] round robin moved someone off level 0\n");
+      fail++;
+    }
+  }
+
+  if (fail == 0){
+    TracePrintf(0, "[TEST] PASS: mlfq (%s)\n", mlfq ? "mlfq" : "round robin");
+  } else {
+    TracePrintf(0, "[TEST] FAIL: mlfq (%s, %d checks failed)\n", mlfq ? "mlfq" : "round robin", fail);
+  }
+  Exit(0);
+}
@@ -0,0 +1,76 @@
+#include "yuser.h"
+#include "ylib.h"
+
+#define CHILDREN 4
+#define PAGES 2
+#define KEY 58
+#define MAGIC 0x5eed
+
+//children share an unnamed segment with the parent through fork,
+//then two unrelated children find each other through a named one
+int main(int argc, char** argv){
+  int* counts = (int*)Shared_Pages(PAGES);
+  if ((int)counts == ERROR){
+    TracePrintf(0, "[TEST] Shared_Pages failed\n");
+    Exit(-1);
+  }
+  TracePrintf(0, "[TEST] %d shared pages at %p\n", PAGES, counts);
+
+  for (int i = 0; i < CHILDREN; i++){
+    int pid = Fork();
+    if (pid == 0){
+      //each child fills its own slot, parent should see every write
+      for (int j = 0; j < 1000; j++){
+        counts[i]++;
+      }
+      Exit(0);
+    }
+  }
+
+  for (int i = 0; i < CHILDREN; i++){
+    Wait(NULL);
+  }
+
+  int bad = 0;
+  for (int i = 0; i < CHILDREN; i++){
+    if (counts[i] != 1000){
+      TracePrintf(0, "[TEST] slot %d has %d, expected 1000\n", i, counts[i]);
+      bad++;
+    }
+  }
+  TracePrintf(0, "[TEST] unnamed segment: %d bad slots\n", bad);
+
+  //parent holds the named segment so it outlives the writer,
+  //writer and reader still look it up by key on their own
+  if (Custom0(KEY, 1, 0, 0) == ERROR){
+    TracePrintf(0, "[TEST] named attach failed\n");
+    Exit(-1);
+  }
+  if (Fork() == 0){
+    int* box = (int*)Custom0(KEY, 1, 0, 0);
+    box[1] = GetPid();
+    box[0] = MAGIC;
+    Exit(0);
+  }
+  if (Fork() == 0){
+    int* box = (int*)Custom0(KEY, 1, 0, 0);
+    for (int tries = 0; tries < 20 && box[0] != MAGIC; tries++){
+      Delay(1);
+    }
+    TracePrintf(0, "[TEST] reader saw %x from pid %d\n", box[0], box[1]);
+    Exit(box[0] == MAGIC ? 0 : -1);
+  }
+
+  int status;
+  Wait(&status);
+  if (status != 0){
+    bad++;
+  }
+  Wait(&status);
+  if (status != 0){
+    bad++;
+  }
+
+  TracePrintf(0, "[TEST] done, %d failures\n", bad);
+  Exit(bad);
+}
@@ -0,0 +1,101 @@
+#include "yuser.h"
+#include "ylib.h"
+#include "kernel/memstats.h"
+
+#define CHILDREN 6
+#define BYTES (600 * 1024)
+#define PAGE 0x2000
+
+int compressible; //"zcache" mode
+
+//byte j of child me's buffer. normally a pattern that won't compress,
+//in zcache mode mostly zeros with a few words of data per page (so it
+//compresses well), except every eighth page which is noise and still
+//has to go to disk
+char expected(int me, int j){
+  if (!compressible){
+    return (char)(me + j);
+  }
+  int page = j / PAGE;
+  if (page % 8 == 7){
+    return (char)((j * 2654435761u + me) >> 13);
+  }
+  return (j % PAGE < 16) ? (char)(me + page) : 0;
+}
+
+//each child fills a big buffer with its own pattern, lets the
+//others run (and push its pages out), then checks it
+//usage: swap [children] [zcache]
+int main(int argc, char** argv){
+  int children = CHILDREN;
+  if (argc > 1){
+    children = atoi(argv[1]);
+  }
+  compressible = (argc > 2 && strcmp(argv[2], "zcache") == 0);
+
+  TracePrintf(0, "[TEST] forking %d children, %d %s bytes each\n", children, BYTES,
+      compressible ? "compressible" : "random");
+
+  int stats[MEMSTAT_COUNT];
+  Custom1((int)stats, MEMSTAT_COUNT, 0, 0);
+  int stores = stats[MEMSTAT_ZCACHE_STORES];
+  int loads = stats[MEMSTAT_ZCACHE_LOADS];
+
+  for (int i = 0; i < children; i++){
+    int pid = Fork();
+    if (pid == 0){
+      int me = GetPid();
+      char* buf = malloc(BYTES);
+      if (buf == NULL){
+        TracePrintf(0, "[TEST] child %d: malloc failed\n", me);
+        Exit(-1);
+      }
+
+      for (int j = 0; j < BYTES; j++){
+        buf[j] = expected(me, j);
+      }
+
+      //give everyone else a turn at memory
+      Delay(5);
+
+      int bad = 0;
+      for (int j = 0; j < BYTES; j++){
+        if (buf[j] != expected(me, j)){
+          bad++;
+        }
+      }
+
+      TracePrintf(0, "[TEST] child %d: %d bad bytes\n", me, bad);
+      Exit(bad == 0 ? 0 : -1);
+    }
+    if (pid == ERROR){
+      TracePrintf(0, "[TEST] fork %d failed\n", i);
+    }
+  }
+
+  int failed = 0;
+  for (int i = 0; i < children; i++){
+    int status;
+    if (Wait(&status) == ERROR){
+      break;
+    }
+    if (status != 0){
+      failed++;
+    }
+  }
+
+  TracePrintf(0, "[TEST] %d children failed\n", failed);
+
+  //reading back right only shows paging works, in zcache mode pages
+  //also have to have gone through the compressed store and come back
+  Custom1((int)stats, MEMSTAT_COUNT, 0, 0);
+  stores = stats[MEMSTAT_ZCACHE_STORES] - stores;
+  loads = stats[MEMSTAT_ZCACHE_LOADS] - loads;
+  TracePrintf(0, "[TEST] compressed store: %d pages in, %d pages back out\n", stores, loads);
+  if (compressible && (stores == 0 || loads == 0)){
+    TracePrintf(0, "[TEST] FAIL: nothing went through the compressed store\n");
+    failed++;
+  }
+
+  Exit(failed);
+}
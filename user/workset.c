@@ -0,0 +1,57 @@
+#include "yuser.h"
+#include "ylib.h"
+#include "kernel/memstats.h"
+
+#define PAGES 16
+#define HOT 2
+#define ROUNDS 80
+#define PAGE 0x2000
+
+//touch only a couple of heap pages for a while, the sampler should
+//notice the rest went cold; then touch all of them and watch the
+//working set grow back
+int touch(char* buf, int pages){
+  int stats[MEMSTAT_COUNT];
+  for (int r = 0; r < ROUNDS; r++){
+    for (int p = 0; p < pages; p++){
+      buf[p * PAGE + r % PAGE]++;
+    }
+    Delay(1);
+  }
+
+  Custom1((int)stats, MEMSTAT_COUNT, 0, 0);
+  TracePrintf(0, "[TEST] touching %d of %d heap pages: working set %d pages (%d rounds, %d sampling faults)\n",
+      pages, PAGES, stats[MEMSTAT_WS_SELF], stats[MEMSTAT_WS_ROUNDS], stats[MEMSTAT_WS_FAULTS]);
+  return stats[MEMSTAT_WS_SELF];
+}
+
+int main(void){
+  char* buf = malloc(PAGES * PAGE);
+  if (buf == NULL){
+    TracePrintf(0, "[TEST] FAIL: workset (malloc failed)\n");
+    Exit(-1);
+  }
+  memset(buf, 1, PAGES * PAGE);
+
+  int cold = touch(buf, HOT);
+  int hot = touch(buf, PAGES);
+
+  //every byte was bumped the same number of times, whatever the sampler did
+  int bad = 0;
+  for (int p = 0; p < PAGES; p++){
+    for (int j = 0; j < PAGE; j++){
+      char want = 1 + (p < HOT ? (j < ROUNDS) : 0) + (j < ROUNDS);
+      if (buf[p * PAGE + j] != want){
+        bad++;
+      }
+    }
+  }
+
+  //(rough estimate, so only ask for most of the newly touched pages)
+  if (bad == 0 && hot >= cold + (PAGES - HOT) / 2){
+    TracePrintf(0, "[TEST] PASS: workset\n");
+  } else {
+    TracePrintf(0, "[TEST] FAIL: workset (%d bad bytes, working set %d then %d)\n", bad, cold, hot);
+  }
+  Exit(0);
+}